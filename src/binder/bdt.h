@@ -0,0 +1,98 @@
+#pragma once
+#include "../common.h"
+#include "../util/umem.h"
+#include <mutex>
+
+/*
+	data half of a split binder. the file is only opened the first time an
+	entry's data is needed, so listing or patching the header never touches it
+*/
+class bdt_t
+{
+	mutable std::mutex m_mutex;
+	mutable UMEM* m_mem = nullptr;
+	mutable bool m_owned = false;
+	std::string m_path = "";
+	std::string m_mode = "rb";
+	std::string m_magic = "";
+
+	public:
+	bdt_t() = default;
+	bdt_t(const bdt_t&) = delete;
+	bdt_t& operator=(const bdt_t&) = delete;
+
+	~bdt_t()
+	{
+		if(m_owned)
+			uclose(m_mem);
+	};
+
+	//opens path with mode once the data is first needed, its magic must match
+	void set(const std::string& path, const std::string& mode, const std::string& magic)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_owned)
+			uclose(m_mem);
+		m_mem = nullptr;
+		m_owned = false;
+		m_path = path;
+		m_mode = mode;
+		m_magic = magic;
+	};
+
+	//uses an already open data file, which the caller keeps ownership of
+	void set(UMEM* mem)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_owned)
+			uclose(m_mem);
+		m_mem = mem;
+		m_owned = false;
+		m_path = mem->m_path;
+	};
+
+	UMEM* get() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_mem != nullptr)
+			return m_mem;
+
+		UMEM* mem = uopen(m_path,m_mode);
+		if(!mem->can_read())
+		{
+			uclose(mem);
+			throw std::runtime_error("bdt_t::get() can't open "+m_path+"\n");
+		}
+
+		char magic[4];
+		if(mem->read_at(magic,4,0) != 4 || m_magic.compare(0,4,magic,4) != 0)
+		{
+			uclose(mem);
+			throw std::runtime_error("bdt_t::get() expected "+m_magic+" in "+m_path+"\n");
+		}
+
+		m_mem = mem;
+		m_owned = true;
+		return m_mem;
+	};
+
+	bool opened() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_mem != nullptr;
+	};
+
+	const std::string& path() const {return m_path;};
+
+	//x.bhd pairs with x.bdt, x.tpfbhd with x.tpfbdt and so on. empty if unknown
+	static std::string path_for(const std::string& bhd_path)
+	{
+		size_t name = bhd_path.find_last_of("\\/");
+		size_t at = bhd_path.rfind("bhd");
+		if(at == std::string::npos || (name != std::string::npos && at < name))
+			return "";
+		std::string path = bhd_path;
+		path.replace(at,3,"bdt");
+		return path;
+	};
+};
\ No newline at end of file
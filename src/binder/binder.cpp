@@ -1,18 +1,631 @@
 #include "binder.h"
 #include "bnd3.h"
 #include "bnd4.h"
+#include "bxf3.h"
+#include "bxf4.h"
+#include "../formats/dcx.h"
+#include "../util/async_io.h"
 #include <stdexcept>
 
-binder_t* binder_t::read(UMEM* mem)
+binder_t* binder_t::read(UMEM* mem, std::string* error)
 {
 	std::string magic = "0000";
 	mem->step_in(0);
 	mem->read(magic.data(),sizeof(char),4);
 	mem->step_out();
 	if(same_str(magic,"BND3"))
-		return bnd3_t::read(mem);
+		return bnd3_t::read(mem,error);
 	else if(same_str(magic,"BND4"))
-		return bnd4_t::read(mem);
+		return bnd4_t::read(mem,error);
+	else if(same_str(magic,"BHF3"))
+		return bxf3_t::read(mem,bdt_t::path_for(mem->m_path),error);
+	else if(same_str(magic,"BHF4"))
+		return bxf4_t::read(mem,bdt_t::path_for(mem->m_path),error);
 	else
 		throw std::runtime_error("binder_t::read() magic: "+magic+"\n");
+};
+
+UMEM* file_header_t::compress_data(i32 level) const
+{
+	UMEM* raw = uopen(m_src_size);
+	if(m_src->read_at(raw->m_data,m_src_size,m_src_offset) != m_src_size)
+	{
+		uclose(raw);
+		throw std::runtime_error("file_header_t::compress_data() short read!\n");
+	}
+
+	UMEM* out = uopen(0);
+	try
+	{
+		dcx_t::compress(out,raw,CMP_DFLT,level);
+	}
+	catch(...)
+	{
+		uclose(raw);
+		uclose(out);
+		throw;
+	}
+	uclose(raw);
+	return out;
+};
+
+//decompresses the dcx an entry flagged as compressed is stored as into dst
+static i32 unpack(UMEM* packed, UMEM* dst)
+{
+	char magic[4];
+	if(packed->read_at(magic,4,0) != 4 || memcmp(magic,"DCX\0",4) != 0)
+		return -1;
+
+	try
+	{
+		dcx_t* dcx = dcx_t::open(packed);
+		dcx->decompress(dst);
+		delete dcx;
+	}
+	catch(std::exception& e)
+	{
+		printf("%s",e.what());
+		return -1;
+	}
+	return 0;
+};
+
+i32 file_header_t::read(UMEM* dst)
+{
+	if(dst == nullptr || !dst->can_write())
+		return -1;
+
+	UMEM* src = data_source();
+	i64 pos = data_source_offset();
+	i64 left = stored_size();
+
+	//entries flagged as compressed are stored as a dcx, replacements are raw
+	if(m_src == nullptr && (m_file_flags & file_flags_e::ff_compressed))
+	{
+		UMEM* packed = src->is_file() ? uopen(left) : uview(src,pos,left);
+		if(packed == nullptr || (src->is_file() && src->read_at(packed->m_data,left,pos) != left))
+		{
+			uclose(packed);
+			return -1;
+		}
+
+		i32 ret = unpack(packed,dst);
+		uclose(packed);
+		return ret;
+	}
+
+	std::vector<u8> buf(std::min<i64>(left,1 << 20));
+	while(left > 0)
+	{
+		i64 r = src->read_at(buf.data(),std::min<i64>(left,buf.size()),pos);
+		if(r <= 0 || dst->write(buf.data(),1,r) != r)
+			return -1;
+		pos += r;
+		left -= r;
+	}
+	return 0;
+};
+
+i32 file_header_t::write(UMEM* src)
+{
+	if(src == nullptr)
+		return -1;
+	set_data(src);
+	return 0;
+};
+
+std::vector<file_header_t::slot_t> binder_t::slot_sizes() const
+{
+	std::vector<file_header_t::slot_t> slots(file_headers.size());
+	for(i32 i = 0; i < file_headers.size(); i++)
+	{
+		const file_header_t& fh = file_headers[i];
+		slots[i].stored_size = fh.stored_size();
+		if(fh.m_src != nullptr)
+			slots[i].uncompressed_size = fh.m_src_size;
+		else
+			slots[i].uncompressed_size = fh.m_uncompressed_size;
+	}
+	return slots;
+};
+
+void binder_t::write_data(UMEM* mem, std::vector<file_header_t::slot_t>& slots, const write_options_t& opts)
+{
+	bool compressing = false;
+	for(i32 i = 0; i < file_headers.size(); i++)
+		compressing |= file_headers[i].needs_compression();
+	bool dedup = opts.dedup && can_alias();
+
+	//only spin up threads when there is something to compress or hash
+	sp<thread_pool_t> pool = nullptr;
+	i64 window = file_headers.size();
+	if(compressing || dedup)
+	{
+		pool = std::make_shared<thread_pool_t>(opts.threads);
+		window = opts.window > 0 ? opts.window : pool->size() * 4;
+	}
+
+	//earlier entry whose data an entry shares, -1 if it has its own
+	std::vector<i64> alias(file_headers.size(),-1);
+	std::vector<u64> hashes(dedup ? file_headers.size() : 0);
+	umap<u64,std::vector<i64>> seen;
+	std::vector<u8> cmp_a(dedup ? 1 << 16 : 0);
+	std::vector<u8> cmp_b(dedup ? 1 << 16 : 0);
+
+	std::vector<u8> buf(1 << 20);
+	i64 pos = mem->tell();
+	for(i64 start = 0; start < file_headers.size(); start += window)
+	{
+		i64 end = std::min<i64>(start + window,file_headers.size());
+
+		//hash this window in parallel, then match it against everything before it
+		if(dedup)
+		{
+			pool->parallel_for(end - start,[&](i64 k)
+			{
+				if(slots[start+k].stored_size > 0)
+					hashes[start+k] = file_headers[start+k].hash_payload();
+			});
+
+			for(i64 i = start; i < end; i++)
+			{
+				if(slots[i].stored_size <= 0)
+					continue;
+
+				//hashes only find candidates, the bytes decide
+				std::vector<i64>& candidates = seen[hashes[i]];
+				for(i64 j : candidates)
+				{
+					if(slots[j].uncompressed_size != slots[i].uncompressed_size)
+						continue;
+					if(file_headers[i].same_payload(file_headers[j],cmp_a,cmp_b))
+					{
+						alias[i] = j;
+						break;
+					}
+				}
+				if(alias[i] < 0)
+					candidates.push_back(i);
+			}
+		}
+
+		//compress this window in parallel, every entry gets its own buffer
+		if(compressing)
+		{
+			pool->parallel_for(end - start,[&](i64 k)
+			{
+				file_header_t& fh = file_headers[start+k];
+				if(!fh.needs_compression() || alias[start+k] >= 0)
+					return;
+				slots[start+k].data = fh.compress_data(opts.level);
+				slots[start+k].stored_size = usize(slots[start+k].data);
+			});
+		}
+
+		//then lay out and write it in order, so the result matches a serial run
+		for(i64 i = start; i < end; i++)
+		{
+			file_header_t::slot_t& slot = slots[i];
+
+			if(alias[i] >= 0)
+			{
+				slot.offset = slots[alias[i]].offset;
+				slot.stored_size = slots[alias[i]].stored_size;
+				continue;
+			}
+
+			//data is 0x10 aligned, empty entries aren't padded
+			if(slot.stored_size > 0)
+				pos = (pos + 0xF) & ~(i64)0xF;
+			slot.offset = pos;
+			pos += slot.stored_size;
+
+			i32 ret = file_headers[i].write_data(mem,slot,buf);
+			uclose(slot.data);
+			slot.data = nullptr;
+			if(ret != 0)
+			{
+				for(i64 j = i + 1; j < end; j++)
+					uclose(slots[j].data);
+				throw std::runtime_error("binder_t::write_data() failed on entry "+std::to_string(i)+"\n");
+			}
+		}
+	}
+};
+
+i32 binder_t::write(UMEM* dst, const write_options_t& opts)
+{
+	std::vector<file_header_t::slot_t> slots;
+	return write(dst,opts,slots);
+};
+
+i32 binder_t::write(UMEM* dst, const write_options_t& opts, std::vector<file_header_t::slot_t>& slots)
+{
+	if(dst == nullptr || !dst->can_write() || split())
+		return -1;
+
+	//the header and names are small, build them in memory
+	UMEM* hdr = uopen(0);
+	write_header(hdr);
+	i64 header_size = usize(hdr);
+
+	//write a placeholder, offsets are only known once compressed sizes are
+	i64 base = dst->tell();
+	if(dst->write(hdr->m_data,1,header_size) != header_size)
+	{
+		uclose(hdr);
+		return -1;
+	}
+
+	slots = slot_sizes();
+	try
+	{
+		write_data(dst,slots,opts);
+	}
+	catch(std::exception& e)
+	{
+		printf("%s",e.what());
+		uclose(hdr);
+		return -1;
+	}
+
+	//patch the real header in
+	for(i32 i = 0; i < file_headers.size(); i++)
+		fill_header(hdr,i,slots[i]);
+
+	i64 end = dst->tell();
+	dst->seek(base,SEEK_SET);
+	i64 r = dst->write(hdr->m_data,1,header_size);
+	dst->seek(end,SEEK_SET);
+	uclose(hdr);
+	return r == header_size ? 0 : -1;
+};
+
+i64 binder_t::slot_capacity(i32 i) const
+{
+	const file_header_t& fh = file_headers[i];
+	i64 offset = fh.m_data_offset;
+
+	//empty entries don't own their offset, and unaligned writes would be moved by the padding
+	if(fh.m_compressed_size <= 0 || offset % 0x10 != 0)
+		return 0;
+
+	i64 next = INT64_MAX;
+	for(i32 j = 0; j < file_headers.size(); j++)
+	{
+		const file_header_t& other = file_headers[j];
+		if(j == i || other.m_compressed_size <= 0)
+			continue;
+		if(other.m_data_offset == offset)
+			return 0; //shared with another entry
+		if(other.m_data_offset > offset)
+			next = std::min(next,other.m_data_offset);
+	}
+	return next - offset;
+};
+
+i32 binder_t::commit(const write_options_t& opts)
+{
+	//split binders keep their data apart from the header, which may not open
+	UMEM* data = nullptr;
+	try
+	{
+		data = source();
+	}
+	catch(std::exception& e)
+	{
+		printf("%s",e.what());
+		return -1;
+	}
+	if(m_mem == nullptr || !m_mem->is_file() || !m_mem->can_write())
+		return -1;
+	if(data == nullptr || !data->is_file() || !data->can_write())
+		return -1;
+
+	std::vector<i32> modified;
+	bool structural = m_restructured;
+	for(i32 i = 0; i < file_headers.size(); i++)
+	{
+		const file_header_t& fh = file_headers[i];
+		structural |= fh.m_header_pos < 0 || fh.m_renamed;
+		if(fh.m_modified)
+			modified.push_back(i);
+	}
+	if(structural)
+	{
+		printf("binder_t::commit() the header changed, compact() or write the binder instead\n");
+		return -1;
+	}
+	if(modified.empty())
+		return 0;
+
+	bool compressing = false;
+	for(i32 i : modified)
+		compressing |= file_headers[i].needs_compression();
+
+	sp<thread_pool_t> pool = nullptr;
+	i64 window = modified.size();
+	if(compressing)
+	{
+		pool = std::make_shared<thread_pool_t>(opts.threads);
+		window = opts.window > 0 ? opts.window : pool->size() * 4;
+	}
+
+	//appended payloads go after everything, including dead space
+	i64 end = usize(data);
+	std::vector<file_header_t::slot_t> slots = slot_sizes();
+	std::vector<u8> buf(1 << 20);
+	try
+	{
+		for(i64 start = 0; start < modified.size(); start += window)
+		{
+			i64 stop = std::min<i64>(start + window,modified.size());
+
+			if(pool != nullptr)
+			{
+				pool->parallel_for(stop - start,[&](i64 k)
+				{
+					i32 i = modified[start+k];
+					if(!file_headers[i].needs_compression())
+						return;
+					slots[i].data = file_headers[i].compress_data(opts.level);
+					slots[i].stored_size = usize(slots[i].data);
+				});
+			}
+
+			for(i64 k = start; k < stop; k++)
+			{
+				i32 i = modified[k];
+				file_header_t& fh = file_headers[i];
+				file_header_t::slot_t& slot = slots[i];
+
+				if(slot.stored_size <= slot_capacity(i))
+				{
+					//the last entry can grow past the end, appends must go after it
+					slot.offset = fh.m_data_offset;
+					end = std::max(end,slot.offset + slot.stored_size);
+				}
+				else
+				{
+					slot.offset = (end + 0xF) & ~(i64)0xF;
+					end = slot.offset + slot.stored_size;
+				}
+
+				//an empty payload writes nothing, so no need to seek
+				i32 ret = 0;
+				if(slot.stored_size > 0)
+				{
+					if(data->seek(std::min(slot.offset,usize(data)),SEEK_SET) != 0)
+						ret = -1;
+					else
+						ret = fh.write_data(data,slot,buf);
+				}
+				uclose(slot.data);
+				slot.data = nullptr;
+
+				if(ret != 0 || !patch_header(m_mem,i,slot))
+					throw std::runtime_error("binder_t::commit() failed on entry "+std::to_string(i)+"\n");
+
+				fh.m_data_offset = slot.offset;
+				fh.m_compressed_size = slot.stored_size;
+				fh.m_uncompressed_size = slot.uncompressed_size;
+				fh.m_src = nullptr;
+				fh.m_modified = false;
+			}
+		}
+	}
+	catch(std::exception& e)
+	{
+		printf("%s",e.what());
+		for(i32 i : modified)
+			uclose(slots[i].data);
+		return -1;
+	}
+
+	fflush(data->m_file);
+	fflush(m_mem->m_file);
+	return 0;
+};
+
+i32 binder_t::write_split(UMEM* hdr_dst, UMEM* data_dst, const write_options_t& opts, std::vector<file_header_t::slot_t>& slots)
+{
+	if(hdr_dst == nullptr || data_dst == nullptr || !hdr_dst->can_write() || !data_dst->can_write())
+		return -1;
+
+	//the header can only be written once the data's layout is known
+	UMEM* hdr = uopen(0);
+	write_header(hdr);
+	i64 header_size = usize(hdr);
+
+	slots = slot_sizes();
+	try
+	{
+		write_data(data_dst,slots,opts);
+	}
+	catch(std::exception& e)
+	{
+		printf("%s",e.what());
+		uclose(hdr);
+		return -1;
+	}
+
+	for(i32 i = 0; i < file_headers.size(); i++)
+		fill_header(hdr,i,slots[i]);
+
+	i64 r = hdr_dst->write(hdr->m_data,1,header_size);
+	uclose(hdr);
+	return r == header_size ? 0 : -1;
+};
+
+void binder_t::adopt(UMEM* mem, const std::vector<file_header_t::slot_t>& slots)
+{
+	mem->big_endian() = m_mem != nullptr && m_mem->big_endian();
+
+	for(i32 i = 0; i < file_headers.size(); i++)
+	{
+		file_header_t& fh = file_headers[i];
+		fh.m_data_offset = slots[i].offset;
+		fh.m_compressed_size = slots[i].stored_size;
+		fh.m_uncompressed_size = slots[i].uncompressed_size;
+		fh.m_header_pos = header_pos(i);
+		fh.m_src = nullptr;
+		fh.m_modified = false;
+		fh.m_renamed = false;
+	}
+	m_restructured = false;
+
+	uclose(m_owned_mem);
+	m_owned_mem = mem;
+	m_mem = mem;
+};
+
+i32 binder_t::replace_file(const std::string& tmp, const std::string& path)
+{
+#ifdef WIN32
+	std::remove(path.c_str());
+#endif
+	if(std::rename(tmp.c_str(),path.c_str()) != 0)
+	{
+		std::remove(tmp.c_str());
+		return -1;
+	}
+	return 0;
+};
+
+i32 binder_t::compact(const std::string& path, const write_options_t& opts)
+{
+	std::string data_path = split() ? bdt_t::path_for(path) : "";
+	if(split() && data_path.empty())
+		return -1;
+
+	std::string tmp = path + ".tmp";
+	std::string data_tmp = data_path + ".tmp";
+	UMEM* out = uopen(tmp,"wb");
+	UMEM* data_out = split() ? uopen(data_tmp,"wb") : nullptr;
+
+	std::vector<file_header_t::slot_t> slots;
+	i32 ret = -1;
+	if(!out->can_write() || (data_out != nullptr && !data_out->can_write()))
+	{
+		ret = -1;
+	}
+	else if(split())
+	{
+		write_data_header(data_out);
+		ret = write_split(out,data_out,opts,slots);
+	}
+	else
+	{
+		ret = write(out,opts,slots);
+	}
+	uclose(out);
+	uclose(data_out);
+
+	if(ret != 0)
+	{
+		std::remove(tmp.c_str());
+		if(split())
+			std::remove(data_tmp.c_str());
+		return -1;
+	}
+	if(split() && replace_file(data_tmp,data_path) != 0)
+	{
+		std::remove(tmp.c_str());
+		return -1;
+	}
+	if(replace_file(tmp,path) != 0)
+		return -1;
+
+	//the binder now describes the new files
+	UMEM* mem = uopen(path,"r+b");
+	if(!mem->can_read())
+	{
+		uclose(mem);
+		return -1;
+	}
+	if(split())
+		reopen_data(data_path);
+	adopt(mem,slots);
+	return 0;
+};
+
+i32 binder_t::read_all(const std::function<void(i32,UMEM*)>& fn, const read_options_t& opts)
+{
+	std::atomic<i32> failed = 0;
+	std::vector<i32> pending;
+	std::vector<io_request_t> requests;
+
+	auto deliver = [&](i32 i, UMEM* data)
+	{
+		if(data == nullptr)
+			failed++;
+		else
+			data->seek(0,SEEK_SET);
+		fn(i,data);
+	};
+
+	for(i32 i = 0; i < file_headers.size(); i++)
+	{
+		file_header_t& fh = file_headers[i];
+		bool queued = fh.m_src == nullptr;
+		try
+		{
+			queued = queued && fh.data_source()->is_file();
+		}
+		catch(std::exception& e)
+		{
+			//a data file that won't open is left queued, source() reports it below
+		}
+		if(queued)
+		{
+			pending.push_back(i);
+			requests.push_back({fh.m_data_offset,fh.m_compressed_size});
+			continue;
+		}
+
+		//replacements and in memory binders are already at hand
+		UMEM* out = uopen(0);
+		if(fh.read(out) != 0)
+		{
+			uclose(out);
+			out = nullptr;
+		}
+		deliver(i,out);
+	}
+
+	if(requests.empty())
+		return failed > 0 ? -1 : 0;
+
+	UMEM* src = nullptr;
+	try
+	{
+		src = source();
+	}
+	catch(std::exception& e)
+	{
+		printf("%s",e.what());
+		for(i32 i : pending)
+			deliver(i,nullptr);
+		return -1;
+	}
+	fflush(src->m_file);
+
+	async_reader_t reader(opts.depth,opts.threads);
+	reader.read(fileno(src->m_file),requests,[&](i64 k, UMEM* packed)
+	{
+		i32 i = pending[k];
+		if(packed != nullptr && (file_headers[i].m_file_flags & file_flags_e::ff_compressed))
+		{
+			UMEM* out = uopen(0);
+			if(unpack(packed,out) != 0)
+			{
+				uclose(out);
+				out = nullptr;
+			}
+			uclose(packed);
+			packed = out;
+		}
+		deliver(i,packed);
+	});
+	return failed > 0 ? -1 : 0;
 };
\ No newline at end of file
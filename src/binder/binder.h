@@ -3,7 +3,12 @@
 #include "../util/strings.h"
 #include "../util/umem.h"
 #include "../util/util.h"
+#include "../util/thread_pool.h"
+#include "../util/hash.h"
+#include "layout.h"
+#include "name_table.h"
 #include <stdexcept>
+#include <string_view>
 
 class binder_t;
 class bnd3_t;
@@ -36,52 +41,274 @@ enum file_flags_e
 
 class file_header_t
 {
+	friend binder_t;
 	friend bnd3_t;
 	friend bnd4_t;
 	binder_t* m_binder = nullptr; //parent binder
-	std::string m_name;
+	u32 m_dir = 0; //interned directory in the parent's name table
+	std::string_view m_base; //basename, stored in the parent's name table
 	i32 m_file_flags = 0;
 	i32 m_id = 0;
 	i32 m_compression_type = 0; //TODO: figure out this
 	i64 m_compressed_size = 0;
 	i64 m_uncompressed_size = 0;
 	i64 m_data_offset = 0;
+	i64 m_header_pos = -1; //position of this entry's header record in the source, -1 if new
 	bool m_modified = false;
+	bool m_renamed = false; //names live in the header, so renames need a full write
+
+	//replacement payload, raw (uncompressed) bytes, not owned
+	UMEM* m_src = nullptr;
+	i64 m_src_offset = 0;
+	i64 m_src_size = 0;
+
+	//position and sizes an entry is given when a binder is written out
+	struct slot_t
+	{
+		i64 offset = 0;
+		i64 stored_size = 0;
+		i64 uncompressed_size = 0;
+		UMEM* data = nullptr; //prepared payload (e.g. compressed), written instead of the source
+	};
  
-	static file_header_t* read_bnd3_fh(binder_t* bnd, UMEM* mem, i32 fmt, bool bbe)
+	static i32 layout_bits(i32 fmt, bool big_endian)
 	{
-		file_header_t* fh = new file_header_t();
-		fh->m_binder = bnd;
+		return (big_endian ? lb_big_endian : 0)
+			| (fmt & format_e::fmt_long_offsets ? lb_long_offsets : 0)
+			| (fmt & format_e::fmt_ids ? lb_ids : 0)
+			| (fmt & (format_e::fmt_names1 | format_e::fmt_names2) ? lb_names : 0)
+			| (fmt & format_e::fmt_compression ? lb_compression : 0)
+			| (fmt == format_e::fmt_names1 ? lb_names1_only : 0);
+	};
 
-		fh->m_file_flags = mem->read_file_flags(bbe);
-		for(i32 i = 0; i < 3; i++)
-			if(!mem->assert_u8(0))
-				throw std::runtime_error("ERR\n");
+	//parses a whole bnd3 file header table, name offsets are returned for a second pass
+	template <i32 BITS>
+	struct bnd3_table_t
+	{
+		static bool fn(file_header_t* fhs, binder_t* bnd, const u8* table, i64 count, bool bbe, i64* name_offsets)
+		{
+			using L = bnd3_fh_layout_t<BITS>;
+			constexpr bool BE = L::big_endian;
 
-		fh->m_compressed_size = mem->read_i32();
+			for(i64 i = 0; i < count; i++)
+			{
+				const u8* p = table + i * L::size;
+				file_header_t& fh = fhs[i];
+				fh.m_binder = bnd;
+				fh.m_file_flags = bbe ? p[L::flags] : flip_byte(p[L::flags]);
+				if((p[1] | p[2] | p[3]) != 0)
+					return false;
+
+				fh.m_compressed_size = load_field<i32,BE>(p+L::compressed_size);
+
+				if constexpr(L::long_offsets)
+					fh.m_data_offset = load_field<i64,BE>(p+L::data_offset);
+				else
+					fh.m_data_offset = load_field<u32,BE>(p+L::data_offset);
+
+				fh.m_id = -1;
+				if constexpr(L::ids)
+					fh.m_id = load_field<i32,BE>(p+L::id);
+
+				name_offsets[i] = -1;
+				if constexpr(L::names)
+					name_offsets[i] = load_field<i32,BE>(p+L::name_offset);
+
+				fh.m_uncompressed_size = -1;
+				if constexpr(L::compression)
+					fh.m_uncompressed_size = load_field<i32,BE>(p+L::uncompressed_size);
+			}
+			return true;
+		};
+	};
 
-		fh->m_data_offset = 0;
-		if(fmt & format_e::fmt_long_offsets)
-			fh->m_data_offset = mem->read_i64();
-		else
-			fh->m_data_offset = mem->read_u32();
+	//parses a whole bnd4 file header table, name offsets are returned for a second pass
+	template <i32 BITS>
+	struct bnd4_table_t
+	{
+		static bool fn(file_header_t* fhs, binder_t* bnd, const u8* table, i64 count, bool bbe, i64* name_offsets)
+		{
+			using L = bnd4_fh_layout_t<BITS>;
+			constexpr bool BE = L::big_endian;
+
+			for(i64 i = 0; i < count; i++)
+			{
+				const u8* p = table + i * L::size;
+				file_header_t& fh = fhs[i];
+				fh.m_binder = bnd;
+				fh.m_file_flags = bbe ? p[L::flags] : flip_byte(p[L::flags]);
+				if((p[1] | p[2] | p[3]) != 0 || load_field<i32,BE>(p+L::minus_one) != -1)
+					return false;
+
+				fh.m_compressed_size = load_field<i64,BE>(p+L::compressed_size);
+
+				fh.m_uncompressed_size = -1;
+				if constexpr(L::compression)
+					fh.m_uncompressed_size = load_field<i64,BE>(p+L::uncompressed_size);
+
+				if constexpr(L::long_offsets)
+					fh.m_data_offset = load_field<i64,BE>(p+L::data_offset);
+				else
+					fh.m_data_offset = load_field<u32,BE>(p+L::data_offset);
+
+				fh.m_id = -1;
+				if constexpr(L::ids)
+					fh.m_id = load_field<i32,BE>(p+L::id);
+
+				name_offsets[i] = -1;
+				if constexpr(L::names)
+					name_offsets[i] = load_field<u32,BE>(p+L::name_offset);
+
+				if constexpr(L::names1_only)
+				{
+					fh.m_id = load_field<i32,BE>(p+L::names1_id);
+					if(load_field<i32,BE>(p+L::names1_id+4) != 0)
+						return false;
+				}
+			}
+			return true;
+		};
+	};
+
+	static i64 bnd3_fh_size(i32 bits)
+	{
+		static constexpr auto sizes = make_size_table<bnd3_fh_layout_t>();
+		return sizes[bits];
+	};
+
+	static i64 bnd4_fh_size(i32 bits)
+	{
+		static constexpr auto sizes = make_size_table<bnd4_fh_layout_t>();
+		return sizes[bits];
+	};
 
-		fh->m_id = -1;
-		if(fmt & format_e::fmt_ids)
-			fh->m_id = mem->read_i32();
+	//bytes a table of count file headers takes
+	static i64 table_size(bool bnd4, i32 fmt, bool big_endian, i64 count)
+	{
+		i32 bits = layout_bits(fmt,big_endian);
+		if(!bnd4)
+			bits &= ~lb_names1_only;
+		return (bnd4 ? bnd4_fh_size(bits) : bnd3_fh_size(bits)) * count;
+	};
 
-		i32 name_offset = -1;
-		if(fmt & (format_e::fmt_names1 | format_e::fmt_names2))
-			name_offset = mem->read_i32();
+	/*
+		reads count file headers with one bulk read of the table followed by a
+		parser specialised for the format, then reads the names
+	*/
+	static bool read_table(
+		bool bnd4, file_header_t* fhs, binder_t* bnd, UMEM* mem, i64 count,
+		i32 fmt, bool big_endian, bool bbe, bool unicode
+	)
+	{
+		static constexpr auto bnd3_parsers = make_layout_table<bnd3_table_t>();
+		static constexpr auto bnd4_parsers = make_layout_table<bnd4_table_t>();
+
+		i32 bits = layout_bits(fmt,big_endian);
+		if(!bnd4)
+			bits &= ~lb_names1_only;
+		i64 fh_size = table_size(bnd4,fmt,big_endian,1);
+
+		i64 table_pos = mem->tell();
+		std::vector<u8> scratch;
+		const u8* table = mem->read_block(fh_size * count,scratch);
+		if(table == nullptr)
+			return false;
 
-		fh->m_uncompressed_size = -1;
-		if(fmt & format_e::fmt_compression)
-			fh->m_uncompressed_size = mem->read_i32();
+		std::vector<i64> name_offsets(count);
+		auto parse = bnd4 ? bnd4_parsers[bits] : bnd3_parsers[bits];
+		if(!parse(fhs,bnd,table,count,bbe,name_offsets.data()))
+			return false;
 
-		if(name_offset != -1)
-			fh->m_name = mem->read_shift_jis(name_offset);
+		for(i64 i = 0; i < count; i++)
+		{
+			if(name_offsets[i] == -1)
+				continue;
+			if(bnd4 && unicode)
+				fhs[i].set_name(mem->read_utf16(name_offsets[i]));
+			else
+				fhs[i].set_name(mem->read_shift_jis(name_offsets[i]));
+		}
 
-		return fh;
+		for(i64 i = 0; i < count; i++)
+			fhs[i].m_header_pos = table_pos + i * fh_size;
+		return true;
+	};
+
+	//rewrites the size and offset fields of a bnd3 header record
+	template <i32 BITS>
+	struct bnd3_patch_t
+	{
+		static bool fn(u8* p, const slot_t& slot)
+		{
+			using L = bnd3_fh_layout_t<BITS>;
+			constexpr bool BE = L::big_endian;
+
+			if(slot.stored_size > INT32_MAX || slot.uncompressed_size > INT32_MAX)
+				return false;
+			store_field<i32>(p+L::compressed_size,slot.stored_size,BE);
+
+			if constexpr(L::long_offsets)
+				store_field<i64>(p+L::data_offset,slot.offset,BE);
+			else if(slot.offset > UINT32_MAX)
+				return false;
+			else
+				store_field<u32>(p+L::data_offset,slot.offset,BE);
+
+			if constexpr(L::compression)
+				store_field<i32>(p+L::uncompressed_size,slot.uncompressed_size,BE);
+			return true;
+		};
+	};
+
+	//rewrites the size and offset fields of a bnd4 header record
+	template <i32 BITS>
+	struct bnd4_patch_t
+	{
+		static bool fn(u8* p, const slot_t& slot)
+		{
+			using L = bnd4_fh_layout_t<BITS>;
+			constexpr bool BE = L::big_endian;
+
+			store_field<i64>(p+L::compressed_size,slot.stored_size,BE);
+
+			if constexpr(L::compression)
+				store_field<i64>(p+L::uncompressed_size,slot.uncompressed_size,BE);
+
+			if constexpr(L::long_offsets)
+				store_field<i64>(p+L::data_offset,slot.offset,BE);
+			else if(slot.offset > UINT32_MAX)
+				return false;
+			else
+				store_field<u32>(p+L::data_offset,slot.offset,BE);
+			return true;
+		};
+	};
+
+	/*
+		points this entry's header record in mem at slot, leaving the rest of
+		the record alone. false if the record can't hold the new values
+	*/
+	bool patch_record(bool bnd4, UMEM* mem, i32 fmt, bool big_endian, const slot_t& slot)
+	{
+		static constexpr auto bnd3_patchers = make_layout_table<bnd3_patch_t>();
+		static constexpr auto bnd4_patchers = make_layout_table<bnd4_patch_t>();
+
+		i32 bits = layout_bits(fmt,big_endian);
+		if(!bnd4)
+			bits &= ~lb_names1_only;
+		i64 fh_size = bnd4 ? bnd4_fh_size(bits) : bnd3_fh_size(bits);
+
+		u8 rec[0x40];
+		if(m_header_pos < 0 || mem->read_at(rec,fh_size,m_header_pos) != fh_size)
+			return false;
+
+		auto patch = bnd4 ? bnd4_patchers[bits] : bnd3_patchers[bits];
+		if(!patch(rec,slot))
+			return false;
+
+		if(mem->seek(m_header_pos,SEEK_SET) != 0)
+			return false;
+		return mem->write(rec,1,fh_size) == fh_size;
 	};
 
 	void write_bnd3_header(UMEM* mem, i32 format, bool bit_big_endian, i32 i)
@@ -109,64 +336,6 @@ class file_header_t
 			mem->reserve_i32("uncompressed_size"+index);
 	};
 
-	static file_header_t* read_bnd4_fh(binder_t* bnd, UMEM* mem, i32 fmt, bool bbe, bool unicode)
-	{
-		file_header_t* fh = new file_header_t();
-		fh->m_binder = bnd;
-		
-		fh->m_file_flags = mem->read_file_flags(bbe);
-
-		auto assert_fn = [&](bool b, std::string err = "")
-		{
-			if(b == false)
-			{
-				delete fh;
-				printf("File Header Assert Error: %s\n",err.c_str());
-			}
-			return b;
-		};
-		
-		for(i32 i = 0; i < 3; i++)
-			if(!assert_fn(mem->assert_i8(0),"padding 0-2"))
-				return nullptr;
-		
-		if(!assert_fn(mem->assert_i32(-1),"padding 3"))
-			return nullptr;
-
-		fh->m_compressed_size = mem->read_i64();
-
-		fh->m_uncompressed_size = -1;
-		if(fmt & format_e::fmt_compression)
-			fh->m_uncompressed_size = mem->read_i64();
-
-		if(fmt & format_e::fmt_long_offsets)
-			fh->m_data_offset = mem->read_i64();
-		else
-			fh->m_data_offset = mem->read_u32();
-		
-		fh->m_id = -1;
-		if(fmt & format_e::fmt_ids)
-			fh->m_id = mem->read_i32();
-
-		if(fmt & (format_e::fmt_names1 | format_e::fmt_names2))
-		{
-			u32 name_offset = mem->read_u32();
-			if(unicode)
-				fh->m_name = mem->read_utf16(name_offset);
-			else
-				fh->m_name = mem->read_shift_jis(name_offset);
-		}
-
-		if(fmt == format_e::fmt_names1)
-		{
-			fh->m_id = mem->read_i32();
-			if(!assert_fn(mem->assert_i32(0),"padding 4"))
-				return nullptr;
-		}
-
-		return fh;
-	};
-
 	void write_bnd4_header(UMEM* mem, i32 format, bool bit_big_endian, i32 i)
 	{
 		mem->write_file_flags(m_file_flags,bit_big_endian);
@@ -209,40 +378,134 @@ class file_header_t
 
 	};
 
-	void write_bnd3_data(UMEM* mem, u8* data, i64 length)
+	void fill_bnd3_header(UMEM* mem, i32 format, i32 i, const slot_t& slot)
 	{
-		if(length > 0)
-			mem->pad(0x10);
+		std::string index = std::to_string(i);
+
+		mem->fill_i32("compressed_size"+index,slot.stored_size);
+
+		if(format & format_e::fmt_long_offsets)
+			mem->fill_i64("data_offset"+index,slot.offset);
+		else
+			mem->fill_u32("data_offset"+index,slot.offset);
+
+		if(format & format_e::fmt_compression)
+			mem->fill_i32("uncompressed_size"+index,slot.uncompressed_size);
+	};
+
+	void fill_bnd4_header(UMEM* mem, i32 format, i32 i, const slot_t& slot)
+	{
+		std::string index = std::to_string(i);
+
+		mem->fill_i64("compressed_size"+index,slot.stored_size);
+
+		if(format & format_e::fmt_compression)
+			mem->fill_i64("uncompressed_size"+index,slot.uncompressed_size);
+
+		if(format & format_e::fmt_long_offsets)
+			mem->fill_i64("data_offset"+index,slot.offset);
+		else
+			mem->fill_u32("data_offset"+index,slot.offset);
+	};
+
+	//where the bytes to be written for this entry currently live
+	UMEM* data_source() const;
+
+	i64 data_source_offset() const {return m_src != nullptr ? m_src_offset : m_data_offset;};
 
-		m_data_offset = mem->m_pos;
-		m_uncompressed_size = length;
-		if(m_file_flags & file_flags_e::ff_compressed)
+	//bytes stored in the binder for this entry, compressed if flagged
+	i64 stored_size() const {return m_src != nullptr ? m_src_size : m_compressed_size;};
+
+	//replacement data flagged as compressed has to be packed into a dcx before writing
+	bool needs_compression() const
+	{
+		return m_src != nullptr && (m_file_flags & file_flags_e::ff_compressed);
+	};
+
+	//packs the replacement data into a new dcx, the caller owns the result
+	UMEM* compress_data(i32 level) const;
+
+	//hash of the bytes the entry is written from, before any compression
+	u64 hash_payload() const
+	{
+		UMEM* src = data_source();
+		i64 pos = data_source_offset();
+		i64 left = stored_size();
+
+		xxh64_t h;
+		std::vector<u8> buf(std::min<i64>(left,1 << 20));
+		while(left > 0)
 		{
-			//TODO: write using compression type
+			i64 r = src->read_at(buf.data(),std::min<i64>(left,buf.size()),pos);
+			if(r <= 0)
+				throw std::runtime_error("file_header_t::hash_payload() short read!\n");
+			h.update(buf.data(),r);
+			pos += r;
+			left -= r;
 		}
-		else
+		return h.digest();
+	};
+
+	//compares the bytes both entries are written from, a and b are scratch
+	bool same_payload(const file_header_t& other, std::vector<u8>& a, std::vector<u8>& b) const
+	{
+		i64 left = stored_size();
+		if(left != other.stored_size() || needs_compression() != other.needs_compression())
+			return false;
+
+		UMEM* src_a = data_source();
+		UMEM* src_b = other.data_source();
+		i64 pos_a = data_source_offset();
+		i64 pos_b = other.data_source_offset();
+		if(src_a == src_b && pos_a == pos_b)
+			return true;
+
+		while(left > 0)
 		{
-			m_compressed_size = length;
-			mem->write(data,1,length);
+			i64 n = std::min<i64>(left,std::min(a.size(),b.size()));
+			if(src_a->read_at(a.data(),n,pos_a) != n || src_b->read_at(b.data(),n,pos_b) != n)
+				return false;
+			if(memcmp(a.data(),b.data(),n) != 0)
+				return false;
+			pos_a += n;
+			pos_b += n;
+			left -= n;
 		}
+		return true;
 	};
 
-	void write_bnd4_data(UMEM* mem, u8* data, i64 length)
+	//streams the entry's bytes to mem at slot.offset through buf
+	i32 write_data(UMEM* mem, const slot_t& slot, std::vector<u8>& buf) const
 	{
-		if(length > 0)
+		if(slot.stored_size > 0)
 			mem->pad(0x10);
+		if(mem->tell() != slot.offset)
+			return -1;
 
-		m_data_offset = mem->m_pos;
-		m_uncompressed_size = length;
-		if(m_file_flags & file_flags_e::ff_compressed)
+		UMEM* src = data_source();
+		i64 pos = data_source_offset();
+		if(slot.data != nullptr)
 		{
-			//TODO: write using compression type
+			src = slot.data;
+			pos = 0;
 		}
-		else
+		else if(needs_compression())
 		{
-			m_compressed_size = length;
-			mem->write(data,1,length);
+			return -1;
 		}
+
+		i64 left = slot.stored_size;
+		while(left > 0)
+		{
+			i64 r = src->read_at(buf.data(),std::min<i64>(left,buf.size()),pos);
+			if(r <= 0)
+				return -1;
+			if(mem->write(buf.data(),1,r) != r)
+				return -1;
+			pos += r;
+			left -= r;
+		}
+		return 0;
 	};
 
 	void write_name(UMEM* mem, i32 format, bool unicode, i32 i)
@@ -252,14 +515,35 @@ class file_header_t
 			std::string index = std::to_string(i);
 			mem->fill_i32("name_offset"+index,mem->m_pos);
 			if(unicode)
-				mem->write_utf16(m_name,true);
+				mem->write_utf16(name(),true);
 			else
-				mem->write_shift_jis(m_name,true);
+				mem->write_shift_jis(name(),true);
 		}
 	};
 
 	public:
-	std::string name() const {return m_name;};
+	//full path, directory and basename joined
+	std::string name() const;
+
+	std::string_view directory() const;
+
+	std::string_view basename() const {return m_base;};
+
+	void set_name(std::string_view name);
+
+	/*
+		replaces the entry's contents with size bytes of src starting at offset,
+		the whole of src if size is negative. src must outlive the next write
+	*/
+	void set_data(UMEM* src, i64 offset = 0, i64 size = -1)
+	{
+		m_src = src;
+		m_src_offset = offset;
+		m_src_size = size < 0 ? usize(src) - offset : size;
+		m_modified = true;
+	};
+
+	bool modified() const {return m_modified;};
 
 	i64 size() const {return std::max<i64>(m_compressed_size,m_uncompressed_size);};
 	
@@ -268,46 +552,219 @@ class file_header_t
 	i64 offset() const {return m_data_offset;};
 
 	i32 id() const {return m_id;};
+
+	i32 flags() const {return m_file_flags;};
 	
-	//read file data from binder and copy it to dst
+	//read file data from binder and copy it to dst, decompressed if stored as a dcx
 	i32 read(UMEM* dst);
 
-	//write file data to binder from src
+	//write file data to binder from src, src must outlive the next write
 	i32 write(UMEM* src);
 };
 
+struct write_options_t
+{
+	i32 threads = 0; //compression threads, 0 uses every hardware thread
+	i32 level = 9;   //zlib level for entries flagged as compressed
+	i32 window = 0;  //entries compressed ahead of the writer, 0 picks one from threads
+	bool dedup = false; //identical payloads share one copy, if the format allows it
+};
+
+struct read_options_t
+{
+	i32 threads = 0; //threads reads are decompressed on, 0 uses every hardware thread
+	i32 depth = 32;  //reads kept in flight at once
+};
+
 class binder_t
 {
 	protected:
 	UMEM* m_mem = nullptr;
-	std::vector<file_header_t*> file_headers = {};
+	UMEM* m_owned_mem = nullptr; //set once a compaction reopens the binder
+	std::vector<file_header_t> file_headers = {}; //owned, contiguous
+	name_table_t m_names;
+	bool m_restructured = false; //entries removed since the binder was read
 
 	virtual void write_header(UMEM* mem) = 0;
 
-	virtual void write_data(UMEM* mem) = 0;
+	//fills the reserved offset and size fields of header i
+	virtual void fill_header(UMEM* mem, i32 i, const file_header_t::slot_t& slot) = 0;
+
+	//patches the offset and size fields of header i where it sits in mem
+	virtual bool patch_header(UMEM* mem, i32 i, const file_header_t::slot_t& slot) = 0;
+
+	//where header i's record starts in a freshly written binder
+	virtual i64 header_pos(i32 i) const = 0;
+
+	//whether entries may point at the same data, formats that forbid it override this
+	virtual bool can_alias() const {return true;};
+
+	//sizes of every entry as they would be written, offsets are assigned while writing
+	std::vector<file_header_t::slot_t> slot_sizes() const;
+
+	//writes entry data in order, compressing flagged entries a window at a time on a pool
+	void write_data(UMEM* mem, std::vector<file_header_t::slot_t>& slots, const write_options_t& opts);
+
+	i32 write(UMEM* dst, const write_options_t& opts, std::vector<file_header_t::slot_t>& slots);
+
+	//writes the header to hdr_dst and the data to data_dst, for split binders
+	i32 write_split(UMEM* hdr_dst, UMEM* data_dst, const write_options_t& opts, std::vector<file_header_t::slot_t>& slots);
+
+	i32 write_split(UMEM* hdr_dst, UMEM* data_dst, const write_options_t& opts)
+	{
+		std::vector<file_header_t::slot_t> slots;
+		return write_split(hdr_dst,data_dst,opts,slots);
+	};
+
+	//points every header at where slots put it, after a rewrite to mem
+	void adopt(UMEM* mem, const std::vector<file_header_t::slot_t>& slots);
+
+	//writes whatever a split binder's data file starts with
+	virtual void write_data_header(UMEM* mem) {};
+
+	//points a split binder at its rewritten data file
+	virtual void reopen_data(const std::string& path) {};
+
+	//moves a finished temporary file over path
+	static i32 replace_file(const std::string& tmp, const std::string& path);
+
+	//bytes entry i may occupy at its current offset without touching another entry
+	i64 slot_capacity(i32 i) const;
 
 	static i64 get_bnd4_file_header_size(i32 format)
 	{
-		return 0x10
-			+ (format & format_e::fmt_long_offsets ? 8 : 4)
-			+ (format & format_e::fmt_compression  ? 8 : 0)
-			+ (format & format_e::fmt_ids ? 4 : 0)
-			+ (format & format_e::fmt_names1 | format_e::fmt_names2 ? 4 : 0)
-			+ (format == format_e::fmt_names1 ? 8 : 0);
+		return file_header_t::bnd4_fh_size(file_header_t::layout_bits(format,false));
 	};
 
-	public:
-	static binder_t* read(UMEM* mem);
+	//un-reverses the format byte as UMEM::read_format does
+	static u8 decode_format(u8 format, bool bit_big_endian)
+	{
+		bool reverse = bit_big_endian || (format & 0x1) != 0 && (format & 0b10000000) == 0;
+		return reverse ? format : flip_byte(format);
+	};
 
-	void write();
+	public:
+	binder_t() = default;
+	binder_t(const binder_t&) = delete;
+	binder_t& operator=(const binder_t&) = delete;
+	virtual ~binder_t() {uclose(m_owned_mem);};
+
+	//header problems are printed, or left in error instead when it is given
+	static binder_t* read(UMEM* mem, std::string* error = nullptr);
+
+	/*
+		writes the binder to dst, streaming entry data from where it currently
+		lives. only the header is built in memory. returns 0 on success
+	*/
+	i32 write(UMEM* dst, const write_options_t& opts = {});
+
+	/*
+		writes modified entries back into the file the binder was read from,
+		which must be opened "r+b". payloads that fit their old slot are
+		overwritten in place, the rest are appended and their header records
+		patched. the space they leave behind is only reclaimed by compact().
+		added, removed or renamed entries change the header, so they fail
+		here and need compact() or a full write. returns 0 on success
+	*/
+	i32 commit(const write_options_t& opts = {});
+
+	/*
+		reads every entry, decompressed, and hands it to fn(i,data) as it
+		arrives. entries in a file are batched through async_reader_t, so fn
+		runs on its threads in no particular order and must be thread safe.
+		fn owns data, which is nullptr if that entry couldn't be read.
+		returns 0 if every entry was read
+	*/
+	i32 read_all(const std::function<void(i32,UMEM*)>& fn, const read_options_t& opts = {});
+
+	/*
+		rewrites the binder to path without dead space, through a temporary
+		file that replaces path once complete. the binder then reads from the
+		new file, so the UMEM it was read from can be closed. split binders
+		take the header's path and rewrite the data file next to it too
+	*/
+	virtual i32 compact(const std::string& path, const write_options_t& opts = {});
+
+	//whether the header and data live in separate files (bhd/bdt)
+	virtual bool split() const {return false;};
 
 	UMEM* data() const {return m_mem;};
 
-	void add_file(file_header_t* file);
+	//where entries that haven't been replaced are read from
+	virtual UMEM* source() const {return m_mem;};
+
+	//adds an empty entry, references to other headers may be invalidated
+	file_header_t& add_file(std::string_view name, i32 id = -1, i32 file_flags = 0)
+	{
+		file_headers.emplace_back();
+		file_header_t& fh = file_headers.back();
+		fh.m_binder = this;
+		fh.m_id = id;
+		fh.m_file_flags = file_flags;
+		fh.m_modified = true;
+		fh.set_name(name);
+		return fh;
+	};
 	
-	void remove_file(file_header_t* file);
+	//returns false if no entry has that name
+	bool remove_file(std::string_view name)
+	{
+		file_header_t* fh = find(name);
+		if(fh == nullptr)
+			return false;
+		file_headers.erase(file_headers.begin() + (fh - file_headers.data()));
+		m_restructured = true;
+		return true;
+	};
 
-	std::vector<file_header_t*> get_headers() const {return file_headers;};
+	std::vector<file_header_t>& get_headers() {return file_headers;};
+
+	const std::vector<file_header_t>& get_headers() const {return file_headers;};
+
+	name_table_t& names() {return m_names;};
+
+	//finds an entry by its full path, nullptr if there is none
+	file_header_t* find(std::string_view path)
+	{
+		size_t split_at = name_table_t::split(path);
+		i64 dir = m_names.find_dir(path.substr(0,split_at));
+		if(dir < 0)
+			return nullptr;
+
+		std::string_view base = path.substr(split_at);
+		for(i32 i = 0; i < file_headers.size(); i++)
+			if(file_headers[i].m_dir == dir && file_headers[i].m_base == base)
+				return &file_headers[i];
+		return nullptr;
+	};
+};
+
+inline std::string file_header_t::name() const
+{
+	std::string_view dir = directory();
+	std::string str;
+	str.reserve(dir.size() + m_base.size());
+	str.append(dir);
+	str.append(m_base);
+	return str;
+};
+
+inline std::string_view file_header_t::directory() const
+{
+	return m_binder->names().dir(m_dir);
+};
+
+inline UMEM* file_header_t::data_source() const
+{
+	return m_src != nullptr ? m_src : m_binder->source();
+};
+
+inline void file_header_t::set_name(std::string_view name)
+{
+	name_table_t::name_t n = m_binder->names().intern(name);
+	m_dir = n.dir;
+	m_base = n.base;
+	m_renamed = m_header_pos >= 0;
 };
 
 class binder_hash_table_t
@@ -318,18 +775,14 @@ class binder_hash_table_t
 		u64 temp;
 		mem->read(&temp,sizeof(i64),1);
 		mem->read(&temp,sizeof(i32),1);
-		if(!mem->assert_u8(0x10))
-			return false;
-		for(i32 i = 0; i < 2; i++)
-			if(!mem->assert_u8(8))
-				return false;
-		if(!mem->assert_u8(0))
-			return false;
-		return true;
+		//compared quietly, the caller reports a mismatch
+		u8 b[4] = {};
+		mem->read(b,sizeof(u8),4);
+		return b[0] == 0x10 && b[1] == 8 && b[2] == 8 && b[3] == 0;
 	};
 
-	static void write(UMEM* mem, std::vector<file_header_t*> headers)
+	static void write(UMEM* mem, const std::vector<file_header_t>& headers)
 	{
 
 	};
-};
+};
\ No newline at end of file
@@ -5,104 +5,83 @@
 class bnd3_t : public binder_t
 {
 	friend binder_t;
+	protected:
 	std::string version;
 	i32 format = 0;
 	i32 unk18 = 0;
 	bool big_endian = false;
 	bool bit_big_endian = false;
-	
-	public:
-	static bnd3_t* read(UMEM* mem)
-	{
-		struct Header
-		{
-			char magic[4];
-			char version[8];
-			uint8_t rawFormat;
-			uint8_t bigEndian;
-			uint8_t bitBigEndian;
-			char unk0F;
-			int32_t fileCount;
-			int32_t fileHeadersEnd;
-			int32_t unk18;
-			int32_t unk1C; //assert 0
-		};
-
-		/*{
-			Header h;
-			mem->read(&h,sizeof(Header),1);
-			std::string magic_str = "";
-			for(i32 i = 0; i < 4; i++)
-				magic_str.push_back(h.magic[i]);
-			printf("magic: %s\n",magic_str.c_str());
-			std::string ver_str = "";
-			for(i32 i = 0; i < 8; i++)
-				ver_str.push_back(h.version[i]);
-			printf("version: %s\n",ver_str.c_str());
-			printf("rawFormat: %u\n",h.rawFormat);
-			printf("bigEndian: %u\n",h.bigEndian);
-			printf("bitBigEndian: %u\n",h.bitBigEndian);
-			printf("unk0F: %u\n",h.unk0F);
-			printf("file_count: %i\n",h.fileCount);
-			printf("unk18: %i\n",h.unk18);
-			printf("unk1C: %i\n",h.unk1C);
-			printf("--------------\n");
-			mem->seek(-sizeof(Header),SEEK_CUR);
-		}*/
-
-		bnd3_t* bnd = new bnd3_t();
 
+	/*
+		parses everything after the magic into bnd. bhf3 headers share the
+		layout, with zeroes where bnd3 keeps its header end and unk18
+	*/
+	static bool read_header(bnd3_t* bnd, UMEM* mem, const bnd3_header_raw_t& h, std::string* error = nullptr)
+	{
+		//failures go to error when given, printed otherwise
 		auto assert_fn = [&](bool b, std::string err = "")
 		{
-			if(b == false)
-			{
-				delete bnd;
-				printf("BND3 Assert Error: %s\n",err.c_str());
-			}
+			if(b == false && error != nullptr)
+				*error = std::string(h.magic,4)+" Assert Error: "+err;
+			else if(b == false)
+				printf("%.4s Assert Error: %s\n",h.magic,err.c_str());
 			return b;
 		};
 
-		{
-			char magic[4];
-			mem->read(magic,sizeof(char),4);
-			std::string magic_str = "";
-			for(i32 i = 0; i < 4; i++)
-				magic_str.push_back(magic[i]);
-			//printf("magic: %s\n",magic_str.c_str());
-			if(!assert_fn(same_str(magic,"BND3"),"got magic "+magic_str))
-			{
-				throw std::runtime_error("Ah\n");
-				return nullptr;
-			}
-		}
+		bnd->version = std::string(h.version,8);
+		bnd->bit_big_endian = h.bit_big_endian;
+		bnd->format = binder_t::decode_format(h.raw_format,bnd->bit_big_endian);
+		bnd->big_endian = h.big_endian;
 
-		bnd->version = "00000000";
-		mem->read(bnd->version.data(),sizeof(char),8);
-		//printf("version: %s\n",bnd->version.c_str());
+		if(!assert_fn(h.unk0F == 0,"unk0F"))
+			return false;
 
-		mem->seek(2,SEEK_CUR);
-		bnd->bit_big_endian = mem->read_u8();
-		mem->seek(-3,SEEK_CUR);
+		bool be = bnd->big_endian || (bnd->format & format_e::fmt_big_endian);
+		mem->big_endian() = be;
 
-		bnd->format = mem->read_format(bnd->bit_big_endian);
+		i32 file_count = load_field<i32>((u8*)&h.file_count,be);
+		bnd->unk18 = load_field<i32>((u8*)&h.unk18,be); //TODO: assert a value for this
 
-		bnd->big_endian = mem->read_u8();
-		mem->assert_u8(bnd->bit_big_endian);
-		mem->assert_u8(0);
-		mem->big_endian() = bnd->big_endian || (bnd->format & format_e::fmt_big_endian);
+		//a corrupt count would otherwise allocate before the table read fails
+		i64 table_end = mem->tell() + file_header_t::table_size(false,bnd->format,be,file_count);
+		if(!assert_fn(file_count >= 0 && table_end <= usize(mem),"file count"))
+			return false;
 
-		i32 file_count = mem->read_i32();
-		i32 file_header_end = mem->read_i32();
-		bnd->unk18 = mem->read_i32(); //TODO: assert a value for this
-		i32 unk1C = mem->read_i32(); //TODO: assert a value for this
+		bnd->m_mem = mem;
+		bnd->file_headers.resize(file_count);
+		return assert_fn(file_header_t::read_table(
+			false,bnd->file_headers.data(),bnd,mem,file_count,
+			bnd->format,be,bnd->bit_big_endian,false
+		),"file headers");
+	};
 
-		//printf("file_count: %i\n",file_count);
+	public:
+	static bnd3_t* read(UMEM* mem, std::string* error = nullptr)
+	{
+		bnd3_header_raw_t h;
+		if(mem->read(&h,sizeof(h),1) != 1)
+			return nullptr;
 
-		for(i32 i = 0; i < file_count; i++)
-			bnd->file_headers.push_back(file_header_t::read_bnd3_fh(
-				bnd,mem,bnd->format,bnd->bit_big_endian
-			));
+		if(memcmp(h.magic,"BND3",4) != 0)
+			throw std::runtime_error("BND3 magic: "+std::string(h.magic,4)+"\n");
 
+		bnd3_t* bnd = new bnd3_t();
+		//names past the end of a memory UMEM throw
+		bool ok = false;
+		try
+		{
+			ok = read_header(bnd,mem,h,error);
+		}
+		catch(...)
+		{
+			delete bnd;
+			throw;
+		}
+		if(!ok)
+		{
+			delete bnd;
+			return nullptr;
+		}
 		return bnd;
 	};
 
@@ -110,34 +89,47 @@ class bnd3_t : public binder_t
 	{
 		mem->big_endian() = bnd->big_endian || (bnd->format & format_e::fmt_big_endian);
 
-		char magic[] = "BND3";
-		mem->write(magic,sizeof(char),4);
+		mem->write((void*)(bnd->split() ? "BHF3" : "BND3"),sizeof(char),4);
 		mem->write(bnd->version.data(),sizeof(char),8);
 
-		mem->write_format(bnd->format,bnd->big_endian);
+		mem->write_format(bnd->format,bnd->bit_big_endian);
 		mem->write_u8(bnd->big_endian);
 		mem->write_u8(bnd->bit_big_endian);
 		mem->write_u8(0);
 
+		//split headers don't record where they end
 		mem->write_i32(bnd->file_headers.size());
-		mem->reserve_i32("file_headers_end");
+		if(bnd->split())
+			mem->write_i32(0);
+		else
+			mem->reserve_i32("file_headers_end");
 		mem->write_i32(bnd->unk18);
 		mem->write_i32(0);
 
 		for(i32 i = 0; i < bnd->file_headers.size(); i++)
-			bnd->file_headers[i]->write_bnd3_header(mem,bnd->format,bnd->bit_big_endian,i);
+			bnd->file_headers[i].write_bnd3_header(mem,bnd->format,bnd->bit_big_endian,i);
 
 		for(i32 i = 0; i < bnd->file_headers.size(); i++)
-			bnd->file_headers[i]->write_name(mem,bnd->format,false,i);
+			bnd->file_headers[i].write_name(mem,bnd->format,false,i);
 
-		mem->fill_i32("file_headers_end",mem->m_pos);
+		if(!bnd->split())
+			mem->fill_i32("file_headers_end",mem->m_pos);
 	};
 
 	void write_header(UMEM* mem) override {write_header(mem,this);};
 
-	void write_data(UMEM* mem) override
+	void fill_header(UMEM* mem, i32 i, const file_header_t::slot_t& slot) override
+	{
+		file_headers[i].fill_bnd3_header(mem,format,i,slot);
+	};
+
+	bool patch_header(UMEM* mem, i32 i, const file_header_t::slot_t& slot) override
+	{
+		return file_headers[i].patch_record(false,mem,format,big_endian || (format & format_e::fmt_big_endian),slot);
+	};
+
+	i64 header_pos(i32 i) const override
 	{
-		//for(i32 i = 0; i < file_headers.size(); i++)
-			//file_headers[i]->write_bnd3_data(mem, u8 *data, i64 length)
+		return 0x20 + i * file_header_t::bnd3_fh_size(file_header_t::layout_bits(format,false) & ~lb_names1_only);
 	};
-};
+};
\ No newline at end of file
@@ -4,6 +4,7 @@
 class bnd4_t : public binder_t
 {
 	friend binder_t;
+	protected:
 	std::string version;
 	i32 format = 0;
 	i8 unk04 = 0;
@@ -13,89 +14,106 @@ class bnd4_t : public binder_t
 	bool unicode = false;
 	u8 extended = 0;
 	
-	static bnd4_t* read(UMEM* mem)
+	/*
+		parses everything after the magic into bnd. bhf4 headers share the
+		layout, with a zero where bnd4 keeps its header end
+	*/
+	static bool read_header(bnd4_t* bnd, UMEM* mem, const bnd4_header_raw_t& h, std::string* error = nullptr)
 	{
-		std::string magic = "\0\0\0\0";
-		mem->read(magic.data(),sizeof(char),4);
-		if(!same_str(magic,"BND4"))
-			return nullptr;
-
-		bnd4_t* bnd = new bnd4_t();
-
+		//failures go to error when given, printed otherwise
 		auto assert_fn = [&](bool b, std::string err = "")
 		{
-			if(b == false)
-			{
-				delete bnd;
-				printf("BND4 Assert Error: %s\n",err.c_str());
-			}
+			if(b == false && error != nullptr)
+				*error = std::string(h.magic,4)+" Assert Error: "+err;
+			else if(b == false)
+				printf("%.4s Assert Error: %s\n",h.magic,err.c_str());
 			return b;
 		};
-		
-		mem->read(&bnd->unk04,sizeof(i8),1);
-		mem->read(&bnd->unk05,sizeof(i8),1);
-
-		for(i32 i = 0; i < 3; i++)
-			if(!assert_fn(mem->assert_i8(0),"padding 0-2"))
-				return nullptr;
-		
-		mem->read(&bnd->big_endian,sizeof(bool),1);
-		mem->read(&bnd->bit_big_endian,sizeof(bool),1);
-		bnd->bit_big_endian = !bnd->bit_big_endian;
-
-		if(!assert_fn(mem->assert_i8(0),"padding 3"))
-			return nullptr;
-
-		mem->big_endian() = bnd->big_endian;
-
-		i32 file_count = mem->read_i32();
-
-		i64 header_size = 0;
-		if(!assert_fn(mem->assert_i64(0x40,&header_size),"header size"))
-			return nullptr;
 
-		bnd->version = "00000000";
-		mem->read(bnd->version.data(),sizeof(char),8);
-		
-		i64 file_header_size = mem->read_i64();
+		bnd->unk04 = h.unk04;
+		bnd->unk05 = h.unk05;
+		bnd->big_endian = h.big_endian;
+		bnd->bit_big_endian = !h.bit_little_endian;
+		bnd->version = std::string(h.version,8);
+		bnd->unicode = h.unicode;
+		bnd->format = binder_t::decode_format(h.raw_format,bnd->bit_big_endian);
+		bnd->extended = h.extended;
 
-		mem->seek(sizeof(i64),SEEK_CUR);
+		bool be = bnd->big_endian;
+		mem->big_endian() = be;
 
-		mem->read(&bnd->unicode,sizeof(bool),1);
-		bnd->format = mem->read_format(bnd->big_endian);
-		bnd->extended = mem->read_i8();
+		if(!assert_fn((h.pad06[0] | h.pad06[1] | h.pad06[2] | h.pad0B) == 0,"padding 0-3"))
+			return false;
 
-		if(!assert_fn(mem->assert_any_u8({0,1,4,0x80},&bnd->extended),"extended"))
-			return nullptr;
+		if(!assert_fn(load_field<i64>((u8*)&h.header_size,be) == 0x40,"header size"))
+			return false;
 
-		if(!assert_fn(mem->assert_i8(0),"padding 4"))
-			return nullptr;
+		if(!assert_fn(h.extended == 0 || h.extended == 1 || h.extended == 4 || h.extended == 0x80,"extended"))
+			return false;
 
-		if(!assert_fn(mem->assert_i32(0),"padding 5"))
-			return nullptr;
+		if(!assert_fn(h.pad33 == 0 && h.pad34 == 0,"padding 4-5"))
+			return false;
 
+		i64 hash_table_offset = load_field<i64>((u8*)&h.hash_table_offset,be);
 		if(bnd->extended == 4)
 		{
-			i64 hash_table_offset = mem->read_i64();
 			mem->step_in(hash_table_offset);
-			if(!assert_fn(binder_hash_table_t::assert(mem),"hash table"))
-				return nullptr;
+			bool valid = binder_hash_table_t::assert(mem);
 			mem->step_out();
+			if(!assert_fn(valid,"hash table"))
+				return false;
 		}
 		else
 		{
-			if(!assert_fn(mem->assert_i64(0),"padding 6"))
-				return nullptr;
+			if(!assert_fn(hash_table_offset == 0,"padding 6"))
+				return false;
 		}
 
-		if(!assert_fn(file_header_size != binder_t::get_bnd4_file_header_size(bnd->format),"header size"))
+		i64 file_header_size = load_field<i64>((u8*)&h.file_header_size,be);
+		if(!assert_fn(file_header_size == binder_t::get_bnd4_file_header_size(bnd->format),"file header size"))
+			return false;
+
+		i32 file_count = load_field<i32>((u8*)&h.file_count,be);
+		//a corrupt count would otherwise allocate before the table read fails
+		i64 table_end = mem->tell() + file_header_t::table_size(true,bnd->format,be,file_count);
+		if(!assert_fn(file_count >= 0 && table_end <= usize(mem),"file count"))
+			return false;
+
+		bnd->m_mem = mem;
+		bnd->file_headers.resize(file_count);
+		return assert_fn(file_header_t::read_table(
+			true,bnd->file_headers.data(),bnd,mem,file_count,
+			bnd->format,be,bnd->bit_big_endian,bnd->unicode
+		),"file headers");
+	};
+
+	public:
+	static bnd4_t* read(UMEM* mem, std::string* error = nullptr)
+	{
+		bnd4_header_raw_t h;
+		if(mem->read(&h,sizeof(h),1) != 1)
+			return nullptr;
+
+		if(memcmp(h.magic,"BND4",4) != 0)
 			return nullptr;
-		
-		for(i32 i = 0; i < file_count; i++)
-			bnd->file_headers.push_back(file_header_t::read_bnd4_fh(
-				bnd,mem,bnd->format,bnd->bit_big_endian,bnd->unicode
-			));
 
+		bnd4_t* bnd = new bnd4_t();
+		//names past the end of a memory UMEM throw
+		bool ok = false;
+		try
+		{
+			ok = read_header(bnd,mem,h,error);
+		}
+		catch(...)
+		{
+			delete bnd;
+			throw;
+		}
+		if(!ok)
+		{
+			delete bnd;
+			return nullptr;
+		}
 		return bnd;
 	};
 
@@ -103,8 +121,7 @@ class bnd4_t : public binder_t
 	{
 		mem->big_endian() = bnd->big_endian;
 
-		char magic[] = "BND4";
-		mem->write(magic,sizeof(char),4);
+		mem->write((void*)(bnd->split() ? "BHF4" : "BND4"),sizeof(char),4);
 
 		mem->write(&bnd->unk04,sizeof(bool),1);
 		mem->write(&bnd->unk05,sizeof(bool),1);
@@ -120,7 +137,11 @@ class bnd4_t : public binder_t
 		mem->write_i64(0x40);
 		mem->write(bnd->version.data(),sizeof(char),8);
 		mem->write_i64(binder_t::get_bnd4_file_header_size(bnd->format));
-		mem->reserve_i64("file_headers_end");
+		//split headers don't record where they end
+		if(bnd->split())
+			mem->write_i64(0);
+		else
+			mem->reserve_i64("file_headers_end");
 
 		mem->write_u8(bnd->unicode);
 		mem->write_format(bnd->format,bnd->bit_big_endian);
@@ -131,10 +152,10 @@ class bnd4_t : public binder_t
 		mem->reserve_i64("hash_table_offset");
 
 		for(i32 i = 0; i < bnd->file_headers.size(); i++)
-			bnd->file_headers[i]->write_bnd4_header(mem,bnd->format,bnd->bit_big_endian,i);
+			bnd->file_headers[i].write_bnd4_header(mem,bnd->format,bnd->bit_big_endian,i);
 
 		for(i32 i = 0; i < bnd->file_headers.size(); i++)
-			bnd->file_headers[i]->write_name(mem,bnd->format,bnd->unicode,i);
+			bnd->file_headers[i].write_name(mem,bnd->format,bnd->unicode,i);
 
 		if(bnd->extended)
 		{
@@ -147,10 +168,24 @@ class bnd4_t : public binder_t
 			mem->fill_i64("hash_table_offset",0);
 		}
 
-		mem->fill_i64("file_headers_end",mem->m_pos);
+		if(!bnd->split())
+			mem->fill_i64("file_headers_end",mem->m_pos);
 	};
 
 	void write_header(UMEM* mem) override {write_header(mem,this);};
 
-	void write_data(UMEM* mem) override {};
+	void fill_header(UMEM* mem, i32 i, const file_header_t::slot_t& slot) override
+	{
+		file_headers[i].fill_bnd4_header(mem,format,i,slot);
+	};
+
+	bool patch_header(UMEM* mem, i32 i, const file_header_t::slot_t& slot) override
+	{
+		return file_headers[i].patch_record(true,mem,format,big_endian,slot);
+	};
+
+	i64 header_pos(i32 i) const override
+	{
+		return 0x40 + i * binder_t::get_bnd4_file_header_size(format);
+	};
 };
\ No newline at end of file
@@ -1,2 +1,78 @@
 #pragma once
-#include "binder.h"
\ No newline at end of file
+#include "binder.h"
+#include "bnd3.h"
+#include "bdt.h"
+
+/*
+	bnd3 split into a header (.bhd, BHF3) and a data file (.bdt, BDF3).
+	data offsets point into the bdt, which is only opened when read from
+*/
+class bxf3_t : public bnd3_t
+{
+	friend binder_t;
+	bdt_t m_bdt;
+
+	protected:
+	void write_data_header(UMEM* bdt) override
+	{
+		bdt->write((void*)"BDF3",sizeof(char),4);
+		bdt->write(version.data(),sizeof(char),8);
+		bdt->write_i32(0);
+	};
+
+	void reopen_data(const std::string& path) override {m_bdt.set(path,"r+b","BDF3");};
+
+	public:
+	//reads the header now, bdt_path is opened on first access to entry data
+	static bxf3_t* read(UMEM* bhd, const std::string& bdt_path, std::string* error = nullptr)
+	{
+		bnd3_header_raw_t h;
+		if(bhd->read(&h,sizeof(h),1) != 1)
+			return nullptr;
+
+		if(memcmp(h.magic,"BHF3",4) != 0)
+			throw std::runtime_error("BHF3 magic: "+std::string(h.magic,4)+"\n");
+
+		bxf3_t* bxf = new bxf3_t();
+		//names past the end of a memory UMEM throw
+		bool ok = false;
+		try
+		{
+			ok = read_header(bxf,bhd,h,error);
+		}
+		catch(...)
+		{
+			delete bxf;
+			throw;
+		}
+		if(!ok)
+		{
+			delete bxf;
+			return nullptr;
+		}
+		bxf->m_bdt.set(bdt_path,bhd->can_write() ? "r+b" : "rb","BDF3");
+		return bxf;
+	};
+
+	//reads the header, taking data from an open bdt the caller keeps ownership of
+	static bxf3_t* read(UMEM* bhd, UMEM* bdt)
+	{
+		bxf3_t* bxf = read(bhd,std::string(""));
+		if(bxf != nullptr)
+			bxf->m_bdt.set(bdt);
+		return bxf;
+	};
+
+	UMEM* source() const override {return m_bdt.get();};
+
+	bool split() const override {return true;};
+
+	//writes the header to bhd and streams every entry's data to bdt
+	i32 write(UMEM* bhd, UMEM* bdt, const write_options_t& opts = {})
+	{
+		if(bdt == nullptr || !bdt->can_write())
+			return -1;
+		write_data_header(bdt);
+		return write_split(bhd,bdt,opts);
+	};
+};
\ No newline at end of file
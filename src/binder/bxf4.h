@@ -1,2 +1,90 @@
 #pragma once
-#include "binder.h"
\ No newline at end of file
+#include "binder.h"
+#include "bnd4.h"
+#include "bdt.h"
+
+/*
+	bnd4 split into a header (.bhd, BHF4) and a data file (.bdt, BDF4).
+	data offsets point into the bdt, which is only opened when read from
+*/
+class bxf4_t : public bnd4_t
+{
+	friend binder_t;
+	bdt_t m_bdt;
+
+	protected:
+	void write_data_header(UMEM* bdt) override
+	{
+		bdt->big_endian() = big_endian;
+		bdt->write((void*)"BDF4",sizeof(char),4);
+		bdt->write(&unk04,sizeof(bool),1);
+		bdt->write(&unk05,sizeof(bool),1);
+		bdt->write_u8(0);
+		bdt->write_u8(0);
+		bdt->write_u8(0);
+		bdt->write(&big_endian,sizeof(bool),1);
+		bdt->write_u8(!bit_big_endian);
+		bdt->write_u8(0);
+		bdt->write_i32(0);
+		bdt->write_i64(0x30);
+		bdt->write(version.data(),sizeof(char),8);
+		bdt->write_i64(0);
+		bdt->write_i64(0);
+	};
+
+	void reopen_data(const std::string& path) override {m_bdt.set(path,"r+b","BDF4");};
+
+	public:
+	//reads the header now, bdt_path is opened on first access to entry data
+	static bxf4_t* read(UMEM* bhd, const std::string& bdt_path, std::string* error = nullptr)
+	{
+		bnd4_header_raw_t h;
+		if(bhd->read(&h,sizeof(h),1) != 1)
+			return nullptr;
+
+		if(memcmp(h.magic,"BHF4",4) != 0)
+			return nullptr;
+
+		bxf4_t* bxf = new bxf4_t();
+		//names past the end of a memory UMEM throw
+		bool ok = false;
+		try
+		{
+			ok = read_header(bxf,bhd,h,error);
+		}
+		catch(...)
+		{
+			delete bxf;
+			throw;
+		}
+		if(!ok)
+		{
+			delete bxf;
+			return nullptr;
+		}
+		bxf->m_bdt.set(bdt_path,bhd->can_write() ? "r+b" : "rb","BDF4");
+		return bxf;
+	};
+
+	//reads the header, taking data from an open bdt the caller keeps ownership of
+	static bxf4_t* read(UMEM* bhd, UMEM* bdt)
+	{
+		bxf4_t* bxf = read(bhd,std::string(""));
+		if(bxf != nullptr)
+			bxf->m_bdt.set(bdt);
+		return bxf;
+	};
+
+	UMEM* source() const override {return m_bdt.get();};
+
+	bool split() const override {return true;};
+
+	//writes the header to bhd and streams every entry's data to bdt
+	i32 write(UMEM* bhd, UMEM* bdt, const write_options_t& opts = {})
+	{
+		if(bdt == nullptr || !bdt->can_write())
+			return -1;
+		write_data_header(bdt);
+		return write_split(bhd,bdt,opts);
+	};
+};
\ No newline at end of file
@@ -0,0 +1,160 @@
+#pragma once
+#include "../common.h"
+#include <array>
+#include <utility>
+
+/*
+	on-disk layouts of binder headers
+	the fixed headers are packed structs, file header tables vary with the
+	format byte so their field offsets are computed per format at compile time
+*/
+
+template <typename T, bool BE>
+inline T load_field(const u8* p)
+{
+	T t;
+	memcpy(&t,p,sizeof(T));
+	if constexpr(BE && sizeof(T) == 2)
+		t = (T)__builtin_bswap16((u16)t);
+	else if constexpr(BE && sizeof(T) == 4)
+		t = (T)__builtin_bswap32((u32)t);
+	else if constexpr(BE && sizeof(T) == 8)
+		t = (T)__builtin_bswap64((u64)t);
+	return t;
+};
+
+template <typename T>
+inline T load_field(const u8* p, bool big_endian)
+{
+	return big_endian ? load_field<T,true>(p) : load_field<T,false>(p);
+};
+
+template <typename T>
+inline void store_field(u8* p, T t, bool big_endian)
+{
+	if(big_endian && sizeof(T) == 2)
+		t = (T)__builtin_bswap16((u16)t);
+	else if(big_endian && sizeof(T) == 4)
+		t = (T)__builtin_bswap32((u32)t);
+	else if(big_endian && sizeof(T) == 8)
+		t = (T)__builtin_bswap64((u64)t);
+	memcpy(p,&t,sizeof(T));
+};
+
+#pragma pack(push,1)
+struct bnd3_header_raw_t
+{
+	char magic[4];
+	char version[8];
+	u8 raw_format;
+	u8 big_endian;
+	u8 bit_big_endian;
+	u8 unk0F; //assert 0
+	i32 file_count;
+	i32 file_headers_end;
+	i32 unk18;
+	i32 unk1C; //assert 0
+};
+
+struct bnd4_header_raw_t
+{
+	char magic[4];
+	u8 unk04;
+	u8 unk05;
+	u8 pad06[3];
+	u8 big_endian;
+	u8 bit_little_endian;
+	u8 pad0B;
+	i32 file_count;
+	i64 header_size; //assert 0x40
+	char version[8];
+	i64 file_header_size;
+	i64 file_headers_end;
+	u8 unicode;
+	u8 raw_format;
+	u8 extended;
+	u8 pad33;
+	i32 pad34;
+	i64 hash_table_offset;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(bnd3_header_raw_t) == 0x20);
+static_assert(sizeof(bnd4_header_raw_t) == 0x40);
+
+//bits of a format that change the file header layout, used to pick a parser
+enum layout_bits_e
+{
+	lb_big_endian   = 1 << 0,
+	lb_long_offsets = 1 << 1,
+	lb_ids          = 1 << 2,
+	lb_names        = 1 << 3,
+	lb_compression  = 1 << 4,
+	lb_names1_only  = 1 << 5, //bnd4 only, format is exactly names1
+	lb_count        = 1 << 6,
+};
+
+template <i32 BITS>
+struct bnd3_fh_layout_t
+{
+	static constexpr bool big_endian   = BITS & lb_big_endian;
+	static constexpr bool long_offsets = BITS & lb_long_offsets;
+	static constexpr bool ids          = BITS & lb_ids;
+	static constexpr bool names        = BITS & lb_names;
+	static constexpr bool compression  = BITS & lb_compression;
+
+	static constexpr i64 flags             = 0x0;
+	static constexpr i64 compressed_size   = 0x4;
+	static constexpr i64 data_offset       = 0x8;
+	static constexpr i64 id                = data_offset + (long_offsets ? 8 : 4);
+	static constexpr i64 name_offset       = id + (ids ? 4 : 0);
+	static constexpr i64 uncompressed_size = name_offset + (names ? 4 : 0);
+	static constexpr i64 size              = uncompressed_size + (compression ? 4 : 0);
+};
+
+template <i32 BITS>
+struct bnd4_fh_layout_t
+{
+	static constexpr bool big_endian   = BITS & lb_big_endian;
+	static constexpr bool long_offsets = BITS & lb_long_offsets;
+	static constexpr bool ids          = BITS & lb_ids;
+	static constexpr bool names        = BITS & lb_names;
+	static constexpr bool compression  = BITS & lb_compression;
+	static constexpr bool names1_only  = BITS & lb_names1_only;
+
+	static constexpr i64 flags             = 0x0;
+	static constexpr i64 minus_one         = 0x4;
+	static constexpr i64 compressed_size   = 0x8;
+	static constexpr i64 uncompressed_size = 0x10;
+	static constexpr i64 data_offset       = uncompressed_size + (compression ? 8 : 0);
+	static constexpr i64 id                = data_offset + (long_offsets ? 8 : 4);
+	static constexpr i64 name_offset       = id + (ids ? 4 : 0);
+	static constexpr i64 names1_id         = name_offset + (names ? 4 : 0);
+	static constexpr i64 size              = names1_id + (names1_only ? 8 : 0);
+};
+
+//builds a table of F<BITS>::fn for every BITS in [0,lb_count)
+template <template <i32> class F, i32... BITS>
+constexpr auto make_layout_table(std::integer_sequence<i32,BITS...>)
+{
+	return std::array{&F<BITS>::fn...};
+};
+
+template <template <i32> class F>
+constexpr auto make_layout_table()
+{
+	return make_layout_table<F>(std::make_integer_sequence<i32,lb_count>{});
+};
+
+//table of L<BITS>::size for every BITS in [0,lb_count)
+template <template <i32> class L, i32... BITS>
+constexpr std::array<i64,lb_count> make_size_table(std::integer_sequence<i32,BITS...>)
+{
+	return {L<BITS>::size...};
+};
+
+template <template <i32> class L>
+constexpr std::array<i64,lb_count> make_size_table()
+{
+	return make_size_table<L>(std::make_integer_sequence<i32,lb_count>{});
+};
\ No newline at end of file
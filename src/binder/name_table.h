@@ -0,0 +1,106 @@
+#pragma once
+#include "../common.h"
+#include <string_view>
+
+/*
+	per-binder storage for entry names
+	paths are split into an interned directory and a basename, both kept in
+	fixed size blocks so views into the table stay valid as it grows
+*/
+
+class name_table_t
+{
+	static constexpr i64 block_bytes = 64 * 1024;
+
+	std::vector<std::unique_ptr<char[]>> m_blocks = {};
+	i64 m_block_used = block_bytes;
+	i64 m_bytes = 0;
+	char* m_shared = nullptr; //block currently being filled
+	std::vector<std::string_view> m_dirs = {""};
+	umap<std::string_view,u32> m_dir_ids = {{"",0}};
+
+	std::string_view store(std::string_view str)
+	{
+		if(str.empty())
+			return {};
+
+		m_bytes += str.size();
+
+		//long strings get their own block so they don't waste the shared one
+		if(str.size() > block_bytes / 4)
+		{
+			m_blocks.push_back(std::make_unique<char[]>(str.size()));
+			memcpy(m_blocks.back().get(),str.data(),str.size());
+			return std::string_view(m_blocks.back().get(),str.size());
+		}
+
+		if(m_block_used + (i64)str.size() > block_bytes)
+		{
+			m_blocks.push_back(std::make_unique<char[]>(block_bytes));
+			m_shared = m_blocks.back().get();
+			m_block_used = 0;
+		}
+
+		char* dst = m_shared + m_block_used;
+		memcpy(dst,str.data(),str.size());
+		m_block_used += str.size();
+		return std::string_view(dst,str.size());
+	};
+
+	public:
+	struct name_t
+	{
+		u32 dir = 0;
+		std::string_view base;
+	};
+
+	name_table_t() = default;
+	name_table_t(const name_table_t&) = delete;
+	name_table_t& operator=(const name_table_t&) = delete;
+
+	//splits a path after its last separator, the directory keeps the separator
+	static size_t split(std::string_view path)
+	{
+		size_t sep = path.find_last_of("\\/");
+		return sep == std::string_view::npos ? 0 : sep + 1;
+	};
+
+	name_t intern(std::string_view path)
+	{
+		size_t split_at = split(path);
+		std::string_view dir = path.substr(0,split_at);
+
+		name_t name;
+		auto it = m_dir_ids.find(dir);
+		if(it != m_dir_ids.end())
+		{
+			name.dir = it->second;
+		}
+		else
+		{
+			name.dir = m_dirs.size();
+			std::string_view stored = store(dir);
+			m_dirs.push_back(stored);
+			m_dir_ids.insert({stored,name.dir});
+		}
+
+		name.base = store(path.substr(split_at));
+		return name;
+	};
+
+	//returns -1 if the directory has never been interned
+	i64 find_dir(std::string_view dir) const
+	{
+		auto it = m_dir_ids.find(dir);
+		if(it == m_dir_ids.end())
+			return -1;
+		return it->second;
+	};
+
+	std::string_view dir(u32 id) const {return m_dirs[id];};
+
+	size_t dir_count() const {return m_dirs.size();};
+
+	//bytes of string data stored, not counting block slack
+	i64 bytes() const {return m_bytes;};
+};
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "zlib_def.h"
+
+i32 zlib_def(UMEM* src, UMEM* dst, i32 level)
+{
+	i32 ret;
+	i32 flush;
+	u32 have;
+	z_stream strm;
+	u8 in[CHUNK];
+	u8 out[CHUNK];
+
+	/* allocate deflate state */
+	strm.zalloc = Z_NULL;
+	strm.zfree  = Z_NULL;
+	strm.opaque = Z_NULL;
+	ret = deflateInit(&strm,level);
+	if(ret != Z_OK)
+		return ret;
+
+	/* compress until end of file */
+	do
+	{
+		strm.avail_in = src->read((char*)in,1,CHUNK);
+		if(src->is_file() && src->error())
+		{
+			(void)deflateEnd(&strm);
+			return Z_ERRNO;
+		}
+		flush = strm.avail_in < CHUNK ? Z_FINISH : Z_NO_FLUSH;
+		strm.next_in = in;
+
+		/* run deflate() on input until output buffer not full */
+		do
+		{
+			strm.avail_out = CHUNK;
+			strm.next_out = out;
+			ret = deflate(&strm,flush);
+			assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+			have = CHUNK - strm.avail_out;
+			if(dst->write((char*)out,1,have) != have)
+			{
+				(void)deflateEnd(&strm);
+				return Z_ERRNO;
+			}
+		} while(strm.avail_out == 0);
+		assert(strm.avail_in == 0);     /* all input will be used */
+
+		/* done when last data in file processed */
+	} while(flush != Z_FINISH);
+	assert(ret == Z_STREAM_END);        /* stream will be complete */
+
+	/* clean up and return */
+	(void)deflateEnd(&strm);
+	return Z_OK;
+};
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "../util/umem.h"
+#include <assert.h>
+#include <stdio.h>
+#include <zlib.h>
+
+#ifndef ZLIB_DEF__
+#define ZLIB_DEF__
+
+#ifndef CHUNK
+#	define CHUNK 16384
+#endif
+
+i32 zlib_def(UMEM* src, UMEM* dst, i32 level);
+
+#endif
\ No newline at end of file
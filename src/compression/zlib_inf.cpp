@@ -1,6 +1,6 @@
 #include "zlib_inf.h"
 
-i32 zlib_inf(UMEM* src, UMEM* dst)
+i32 zlib_inf(UMEM* src, UMEM* dst, i64 limit)
 {
 	//printf("Beginning inflation at position: %x\n", ftell(source));
 
@@ -9,6 +9,7 @@ i32 zlib_inf(UMEM* src, UMEM* dst)
 	z_stream strm;
 	u8 in[CHUNK];
 	u8 out[CHUNK];
+	i64 written = 0;
 
 	/* allocate inflate state */
 	strm.zalloc = Z_NULL;
@@ -55,6 +56,12 @@ i32 zlib_inf(UMEM* src, UMEM* dst)
 				(void)inflateEnd(&strm);
 				return Z_ERRNO;
 			}
+			written += have;
+			if(limit >= 0 && written >= limit)
+			{
+				(void)inflateEnd(&strm);
+				return Z_OK;
+			}
 		} while(strm.avail_out == 0);
 
 		/* done when inflate() says it's done */
@@ -18,6 +18,7 @@
 #	define CHUNK 16384
 #endif
 
-i32 zlib_inf(UMEM* src, UMEM* dst);
+//inflates src into dst, stopping early once at least limit bytes are out when limit isn't -1
+i32 zlib_inf(UMEM* src, UMEM* dst, i64 limit = -1);
 
 #endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "../common.h"
 #include "../util/umem.h"
+#include "../compression/zlib_def.h"
 #include "../compression/zlib_inf.h"
 #include <stdexcept>
 
@@ -17,8 +18,9 @@ class dcx_t
 	UMEM* m_src = nullptr;
 	u32 m_uncompressed_size = 0;
 	char m_format[4];
+	i64 m_payload = 0; //where the compressed data starts in m_src
 
-	static void decompress(UMEM* dst, UMEM* src, i32 compression_type)
+	static void decompress(UMEM* dst, UMEM* src, i32 compression_type, i64 limit = -1)
 	{
 		i32 ret = 0;
 		std::string type = std::to_string(compression_type);
@@ -27,7 +29,7 @@ class dcx_t
 		{
 			case(CMP_DFLT):
 				src->seek(4,SEEK_CUR);
-				ret = zlib_inf(src,dst);
+				ret = zlib_inf(src,dst,limit);
 				break;
 			default:
 				throw std::runtime_error("Unknown tpye: "+type+"\n");
@@ -38,16 +40,59 @@ class dcx_t
 			throw std::runtime_error("Decompress failed! Type: "+type+", error: "+err+"\n");
 	};
 
-	static void compress(UMEM* dst, UMEM* src, i32 compression_type)
+	public:
+	//writes src as a complete dcx container to dst
+	static void compress(UMEM* dst, UMEM* src, i32 compression_type, i32 level = 9)
 	{
-
+		std::string type = std::to_string(compression_type);
+		if(compression_type != CMP_DFLT)
+			throw std::runtime_error("Unsupported compression type: "+type+"\n");
+
+		bool be = dst->big_endian();
+		dst->big_endian() = true;
+
+		dst->write((void*)"DCX\0",sizeof(char),4);
+		dst->write_i32(0x10000);
+		dst->write_i32(0x18);
+		dst->write_i32(0x24);
+		dst->write_i32(0x44);
+		dst->write_i32(0x4C);
+		dst->write((void*)"DCS\0",sizeof(char),4);
+		dst->write_u32(usize(src) - src->tell());
+		dst->reserve_u32("dcx_compressed_size");
+		dst->write((void*)"DCP\0",sizeof(char),4);
+		dst->write((void*)"DFLT",sizeof(char),4);
+		dst->write_i32(0x20);
+		dst->write_u8(level);
+		dst->write_u8(0);
+		dst->write_u8(0);
+		dst->write_u8(0);
+		dst->write_i32(0);
+		dst->write_i32(0);
+		dst->write_i32(0);
+		dst->write_i32(0x00010100);
+		dst->write((void*)"DCA\0",sizeof(char),4);
+		dst->write_i32(8);
+
+		i64 start = dst->tell();
+		i32 ret = zlib_def(src,dst,level);
+		if(ret != 0)
+		{
+			dst->big_endian() = be;
+			throw std::runtime_error("Compress failed! Type: "+type+", error: "+std::to_string(ret)+"\n");
+		}
+		dst->fill_u32("dcx_compressed_size",dst->tell() - start);
+		dst->big_endian() = be;
 	};
 
-	public:
 	static dcx_t* open(UMEM* src)
 	{
 		dcx_t* dcx = new dcx_t();
 
+		//dcx headers are always big endian
+		bool be = src->big_endian();
+		src->big_endian() = true;
+
 		char magic[4];
 		src->read(magic,sizeof(char),4);
 
@@ -87,12 +132,63 @@ class dcx_t
 			//TODO: this
 		}
 
+		src->big_endian() = be;
 		dcx->m_src = src;
+		dcx->m_payload = src->tell();
 		return dcx;
 	};
 
 	void decompress(UMEM* dst)
 	{
-		decompress(dst,m_src,CMP_DFLT);
+		decompress(dst,-1);
+	};
+
+	/*
+		only the start of the payload, at least bytes of it unless it is
+		shorter, for reading a header without inflating the rest. may be
+		called again for more
+	*/
+	void decompress(UMEM* dst, i64 bytes)
+	{
+		if(memcmp(m_format,"DFLT",4) != 0)
+			throw std::runtime_error("Unsupported dcx format: "+std::string(m_format,4)+"\n");
+		m_src->seek(m_payload,SEEK_SET);
+		decompress(dst,m_src,CMP_DFLT,bytes);
 	};
+
+	static bool is_dcx(UMEM* mem)
+	{
+		char magic[4];
+		return mem->read_at(magic,4,0) == 4 && memcmp(magic,"DCX\0",4) == 0;
+	};
+
+	//decompresses mem for as long as it holds a dcx, nullptr if it wasn't one
+	static sp<UMEM> inflate(UMEM* mem)
+	{
+		sp<UMEM> out = nullptr;
+		while(is_dcx(mem))
+		{
+			mem->seek(0,SEEK_SET);
+			dcx_t* dcx = open(mem);
+			sp<UMEM> inner(uopen(dcx->uncompressed_size()),uclose);
+			try
+			{
+				dcx->decompress(inner.get());
+			}
+			catch(...)
+			{
+				delete dcx;
+				throw;
+			}
+			delete dcx;
+			inner->seek(0,SEEK_SET);
+			out = inner;
+			mem = out.get();
+		}
+		return out;
+	};
+
+	u32 uncompressed_size() const {return m_uncompressed_size;};
+
+	std::string_view format() const {return std::string_view(m_format,4);};
 };
@@ -0,0 +1,85 @@
+#pragma once
+#include "../../math/vec.h"
+#include "../../util/types.h"
+#include <algorithm>
+#include <float.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace flver
+{
+	//a box nothing is inside yet, any point grows it to just that point
+	inline bounding_box_t empty_bounds()
+	{
+		bounding_box_t box = {};
+		box.min = vec3f(FLT_MAX,FLT_MAX,FLT_MAX);
+		box.max = vec3f(-FLT_MAX,-FLT_MAX,-FLT_MAX);
+		return box;
+	};
+
+	inline void grow(bounding_box_t& box, const bounding_box_t& other)
+	{
+		for(i32 c = 0; c < 3; c++)
+		{
+			box.min[c] = std::min(box.min[c],other.min[c]);
+			box.max[c] = std::max(box.max[c],other.max[c]);
+		}
+	};
+
+	/*
+		grows box to hold count points. with AVX2 eight points are three
+		loads of interleaved xyz, each lane of the three accumulators always
+		seeing the same component, so the loop needs no shuffles and the
+		lanes are only sorted out by component at the end
+	*/
+	inline void grow(bounding_box_t& box, const vec3f* points, i64 count)
+	{
+		const float* p = (const float*)points;
+		i64 i = 0;
+#ifdef __AVX2__
+		if(count >= 8)
+		{
+			__m256 lo[3], hi[3];
+			for(i32 k = 0; k < 3; k++)
+				lo[k] = hi[k] = _mm256_loadu_ps(p+k*8);
+			for(i = 8; i + 8 <= count; i += 8)
+			{
+				for(i32 k = 0; k < 3; k++)
+				{
+					__m256 v = _mm256_loadu_ps(p+i*3+k*8);
+					lo[k] = _mm256_min_ps(lo[k],v);
+					hi[k] = _mm256_max_ps(hi[k],v);
+				}
+			}
+
+			float l[24], h[24];
+			for(i32 k = 0; k < 3; k++)
+			{
+				_mm256_storeu_ps(l+k*8,lo[k]);
+				_mm256_storeu_ps(h+k*8,hi[k]);
+			}
+			for(i32 j = 0; j < 24; j++)
+			{
+				box.min[j%3] = std::min(box.min[j%3],l[j]);
+				box.max[j%3] = std::max(box.max[j%3],h[j]);
+			}
+		}
+#endif
+		for(; i < count; i++)
+		{
+			for(i32 c = 0; c < 3; c++)
+			{
+				box.min[c] = std::min(box.min[c],p[i*3+c]);
+				box.max[c] = std::max(box.max[c],p[i*3+c]);
+			}
+		}
+	};
+
+	inline bounding_box_t bounds(const vec3f* points, i64 count)
+	{
+		bounding_box_t box = empty_bounds();
+		grow(box,points,count);
+		return box;
+	};
+};
\ No newline at end of file
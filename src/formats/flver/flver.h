@@ -1,5 +1,5 @@
 #pragma once
-#include "../../math/vec.h"
+#include "../../math/mat.h"
 #include "../../util/umem.h"
 #include "../../util/types.h"
 #include <algorithm>
@@ -151,7 +151,7 @@ namespace flver
 
 		static sp<dummy_t> create(UMEM* mem, i32 version)
 		{
-			sp<dummy_t> dum = sp<dummy_t>();
+			sp<dummy_t> dum = std::make_shared<dummy_t>();
 			dum->read(mem,version);
 			return dum;
 		};
@@ -211,9 +211,15 @@ namespace flver
 		vec3f bounding_box_max;
 		i32 unk3c;
 
+		//scale, then rotation about x, z and y, then translation, relative to the parent
+		mat4f local_transform() const
+		{
+			return mat4f::euler_xzy(scale,rotation,translation);
+		};
+
 		static sp<bone_t> create(UMEM* mem, bool unicode)
 		{
-			sp<bone_t> bone = sp<bone_t>();
+			sp<bone_t> bone = std::make_shared<bone_t>();
 			bone->read(mem,unicode);
 			return bone;
 		};
@@ -231,8 +237,13 @@ namespace flver
 			bounding_box_min = mem->read_v3f();
 			unk3c = mem->read_i32();
 			bounding_box_max = mem->read_v3f();
-			mem->assert_u8(0x34);
-			mem->assert_u8(0x00);
+			for(i32 i = 0; i < 0x34; i++)
+				mem->assert_u8(0);
+
+			if(unicode)
+				name = mem->read_utf16(name_offset);
+			else
+				name = mem->read_shift_jis(name_offset);
 		};
 
 		void write(UMEM* mem, i32 index)
@@ -248,8 +259,8 @@ namespace flver
 			mem->write_v3f(bounding_box_min);
 			mem->write_i32(unk3c);
 			mem->write_v3f(bounding_box_max);
-			mem->write_u8(0x34);
-			mem->write_u8(0x00);
+			for(i32 i = 0; i < 0x34; i++)
+				mem->write_u8(0);
 		};
 
 		void write_strings(UMEM* mem, bool unicde, i32 index)
@@ -292,6 +303,28 @@ namespace flver
 		LOT_EDGE_COMPRESSED = 0xf0,
 	};
 
+	//bytes a member of this type takes up in a vertex, 0 if unknown
+	inline i32 layout_type_size(u32 type)
+	{
+		switch(type)
+		{
+			case(LOT_BYTE4A):
+			case(LOT_BYTE4B):
+			case(LOT_BYTE4C):
+			case(LOT_UV):
+			case(LOT_BYTE4E): return 4;
+			case(LOT_FLOAT2):
+			case(LOT_UV_PAIR):
+			case(LOT_SHORT_BONE_INDICES):
+			case(LOT_SHORT4_TO_FLOAT4A):
+			case(LOT_SHORT4_TO_FLOAT4B): return 8;
+			case(LOT_FLOAT3): return 12;
+			case(LOT_FLOAT4): return 16;
+			case(LOT_EDGE_COMPRESSED): return 1;
+		}
+		return 0;
+	};
+
 	struct layout_member_t
 	{
 		i32 unk00;
@@ -307,7 +340,7 @@ namespace flver
 			type = mem->read_u32();
 			semantic = mem->read_u32();
 			index = mem->read_i32();
-			//TODO: calculate size
+			size = layout_type_size(type);
 		};
 
 		void write(UMEM* mem, i32 struct_offset)
@@ -403,287 +436,8 @@ namespace flver
 		std::queue<vec4f> tangent_queue;
 		std::queue<vertex_color_t> color_queue;
 
-		void read(UMEM* mem, std::vector<layout_member_t*> layout, float uv_factor)
-		{
-			for(i32 i = 0; i < layout.size(); i++)
-			{
-				layout_member_t* member = layout[i];
-				if(member->semantic == layout_semantic_e::LOS_POSITION)
-				{
-					if(member->type == layout_type_e::LOT_FLOAT3)
-					{
-						position = mem->read_v3f();
-					}
-					else if(member->type == layout_type_e::LOT_FLOAT4)
-					{
-						position = mem->read_v3f();
-						mem->read_f32();
-					}
-					else if(member->type == layout_type_e::LOT_EDGE_COMPRESSED)
-					{
-						printf("Error: Edge compressed vertex!\n");
-						position = {0.0f,0.0f,0.0f};
-					}
-					else
-					{
-						printf("member semantic: %x\n",member->semantic);
-						printf("member type: %x\n",member->type);
-						throw std::runtime_error("flver::vertex_t unknown member type!\n");
-					}
-				}
-				else if(member->semantic == layout_semantic_e::LOS_BONE_WEIGHTS)
-				{
-					if(member->type == layout_type_e::LOT_BYTE4A)
-					{
-						for(i32 i = 0; i < 4; i++)
-							bone_weights[i] = (float)mem->read_i8() / 127.0f;
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4C)
-					{
-						for(i32 i = 0; i < 4; i++)
-							bone_weights[i] = (float)mem->read_u8() / 255.0f;
-					}
-					else if(member->type == layout_type_e::LOT_UV_PAIR)
-					{
-						for(i32 i = 0; i < 4; i++)
-							bone_weights[i] = (float)mem->read_i16() / 32767.0f;
-					}
-					else if(member->type == layout_type_e::LOT_SHORT4_TO_FLOAT4A)
-					{
-						for(i32 i = 0; i < 4; i++)
-							bone_weights[i] = (float)mem->read_i16() / 32767.0f;
-					}
-					else
-					{
-						printf("member semantic: %x\n",member->semantic);
-						printf("member type: %x\n",member->type);
-						throw std::runtime_error("flver::vertex_t unknown member type!\n");
-					}
-				}
-				else if(member->semantic == layout_semantic_e::LOS_BONE_INDICES)
-				{
-					if(member->type == layout_type_e::LOT_BYTE4B)
-					{
-						for(i32 i = 0; i < 4; i++)
-							bone_indices[i] = mem->read_u8();
-					}
-					else if(member->type == layout_type_e::LOT_SHORT_BONE_INDICES)
-					{
-						for(i32 i = 0; i < 4; i++)
-							bone_indices[i] = mem->read_u16();
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4E)
-					{
-						for(i32 i = 0; i < 4; i++)
-							bone_indices[i] = mem->read_u8();
-					}
-					else
-					{
-						printf("member semantic: %x\n",member->semantic);
-						printf("member type: %x\n",member->type);
-						throw std::runtime_error("flver::vertex_t unknown member type!\n");
-					}
-				}
-				else if(member->semantic == layout_semantic_e::LOS_NORMAL)
-				{
-					if(member->type == layout_type_e::LOT_FLOAT3)
-					{
-						normal = mem->read_v3f();
-					}
-					else if(member->type == layout_type_e::LOT_FLOAT4)
-					{
-						normal = mem->read_v3f();
-						float w = mem->read_f32();
-						normal_w = (i32)w;
-						if(w != normal_w)
-							throw std::runtime_error("Bad W!\n");
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4A)
-					{
-						normal = read_u8_norm_xyz(mem);
-						normal_w = mem->read_u8();
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4B)
-					{
-						normal = read_u8_norm_xyz(mem);
-						normal_w = mem->read_u8();
-					}
-					else if(member->type == layout_type_e::LOT_SHORT2_TO_FLOAT2)
-					{
-						normal_w = mem->read_u8();
-						normal = read_i8_norm_zyx(mem);
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4C)
-					{
-						normal = read_u8_norm_xyz(mem);
-						normal_w = mem->read_u8();
-					}
-					else if(member->type == layout_type_e::LOT_SHORT4_TO_FLOAT4A)
-					{
-						normal = read_i16_norm_xyz(mem);
-						normal_w = mem->read_i16();
-					}
-					else if(member->type == layout_type_e::LOT_SHORT4_TO_FLOAT4B)
-					{
-						normal = read_u16_norm_xyz(mem);
-						normal_w = mem->read_i16();
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4E)
-					{
-						normal = read_u8_norm_xyz(mem);
-						normal_w = mem->read_u8();
-					}
-					else
-					{
-						printf("member semantic: %x\n",member->semantic);
-						printf("member type: %x\n",member->type);
-						throw std::runtime_error("flver::vertex_t unknown member type!\n");
-					}
-				}
-				else if(member->semantic == layout_semantic_e::LOS_UV)
-				{
-					if(member->type == layout_type_e::LOT_FLOAT2)
-					{
-						uvs.push_back(vec3f(mem->read_f32(),mem->read_f32(),0.0f));
-					}
-					else if(member->type == layout_type_e::LOT_FLOAT3)
-					{
-						uvs.push_back(mem->read_v3f());
-					}
-					else if(member->type == layout_type_e::LOT_FLOAT4)
-					{
-						uvs.push_back(vec3f(mem->read_f32(),mem->read_f32(),0.0f));
-						uvs.push_back(vec3f(mem->read_f32(),mem->read_f32(),0.0f));
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4A)
-					{
-						uvs.push_back(vec3f(mem->read_i16(),mem->read_i16(),0.0f)/uv_factor);
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4B)
-					{
-						uvs.push_back(vec3f(mem->read_i16(),mem->read_i16(),0.0f)/uv_factor);
-					}
-					else if(member->type == layout_type_e::LOT_SHORT2_TO_FLOAT2)
-					{
-						uvs.push_back(vec3f(mem->read_i16(),mem->read_i16(),0.0f)/uv_factor);
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4C)
-					{
-						uvs.push_back(vec3f(mem->read_i16(),mem->read_i16(),0.0f)/uv_factor);
-					}
-					else if(member->type == layout_type_e::LOT_UV)
-					{
-						uvs.push_back(vec3f(mem->read_i16(),mem->read_i16(),0.0f)/uv_factor);
-					}
-					else if(member->type == layout_type_e::LOT_UV_PAIR)
-					{
-						uvs.push_back(vec3f(mem->read_i16(),mem->read_i16(),0.0f)/uv_factor);
-						uvs.push_back(vec3f(mem->read_i16(),mem->read_i16(),0.0f)/uv_factor);
-					}
-					else if(member->type == layout_type_e::LOT_SHORT4_TO_FLOAT4B)
-					{
-						uvs.push_back(vec3f(
-							mem->read_i16(),mem->read_i16(),mem->read_i16()
-						)/uv_factor);
-						mem->read_i16();
-					}
-					else
-					{
-						printf("member semantic: %x\n",member->semantic);
-						printf("member type: %x\n",member->type);
-						throw std::runtime_error("flver::vertex_t unknown member type!\n");
-					}
-				}
-				else if(member->semantic == layout_semantic_e::LOS_TANGENT)
-				{
-					if(member->type == layout_type_e::LOT_FLOAT4)
-					{
-						tangents.push_back(mem->read_v4f());
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4A)
-					{
-						tangents.push_back(read_u8_norm_xyzw(mem));
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4B)
-					{
-						tangents.push_back(read_u8_norm_xyzw(mem));
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4C)
-					{
-						tangents.push_back(read_u8_norm_xyzw(mem));
-					}
-					else if(member->type == layout_type_e::LOT_SHORT4_TO_FLOAT4A)
-					{
-						tangents.push_back(read_i16_norm_xyzw(mem));
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4E)
-					{
-						tangents.push_back(read_u8_norm_xyzw(mem));
-					}
-					else
-					{
-						printf("member semantic: %x\n",member->semantic);
-						printf("member type: %x\n",member->type);
-						throw std::runtime_error("flver::vertex_t unknown member type!\n");
-					}
-				}
-				else if(member->semantic == layout_semantic_e::LOS_BITANGENT)
-				{
-					if(member->type == layout_type_e::LOT_BYTE4A)
-					{
-						bitangent = read_u8_norm_xyzw(mem);
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4B)
-					{
-						bitangent = read_u8_norm_xyzw(mem);
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4C)
-					{
-						bitangent = read_u8_norm_xyzw(mem);
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4E)
-					{
-						bitangent = read_u8_norm_xyzw(mem);
-					}
-					else
-					{
-						printf("member semantic: %x\n",member->semantic);
-						printf("member type: %x\n",member->type);
-						throw std::runtime_error("flver::vertex_t unknown member type!\n");
-					}
-				}
-				else if(member->semantic == layout_semantic_e::LOS_VERTEX_COLOR)
-				{
-					if(member->type == layout_type_e::LOT_FLOAT4)
-					{
-						vertex_color_t v; v.read_rgba_f32(mem);
-						colors.push_back(v);
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4A)
-					{
-						vertex_color_t v; v.read_rgba_u8(mem);
-						colors.push_back(v);
-					}
-					else if(member->type == layout_type_e::LOT_BYTE4C)
-					{
-						vertex_color_t v; v.read_rgba_u8(mem);
-						colors.push_back(v);
-					}
-					else
-					{
-						printf("member semantic: %x\n",member->semantic);
-						printf("member type: %x\n",member->type);
-						throw std::runtime_error("flver::vertex_t unknown member type!\n");
-					}
-				}
-				else
-				{
-					printf("member semantic: %x\n",member->semantic);
-					printf("member type: %x\n",member->type);
-					throw std::runtime_error("flver::vertex_t unknown member semantic!\n");
-				}
-			}
-		};
+		//decodes one vertex, buffers should compile a vertex_plan_t once instead
+		void read(UMEM* mem, const std::vector<layout_member_t*>& layout, float uv_factor);
 
 		void write(UMEM* mem, std::vector<layout_member_t*> layout, float uv_factor)
 		{
@@ -996,4 +750,145 @@ namespace flver
 				tangent_queue.push(tangents[i]);
 		};
 	};
-};
\ No newline at end of file
+
+	/*
+		a mesh's vertices as one contiguous array per attribute, which is how
+		they are decoded and processed. arrays only exist for attributes some
+		buffer of the mesh has. uv, tangent and color channels stack up in
+		layout order across buffers, the order vertex_t's vectors fill in.
+		vertex() gives the old per vertex object where one is wanted
+	*/
+	struct vertex_arrays_t
+	{
+		enum attribute_e
+		{
+			VA_POSITION     = 1 << 0,
+			VA_BONE_WEIGHTS = 1 << 1,
+			VA_BONE_INDICES = 1 << 2,
+			VA_NORMAL       = 1 << 3,
+			VA_BITANGENT    = 1 << 4,
+		};
+
+		i64 count = 0;
+		u32 attributes = 0;
+		std::vector<vec3f> positions = {};
+		std::vector<vertex_bone_weights_t> bone_weights = {};
+		std::vector<vertex_bone_indices_t> bone_indices = {};
+		std::vector<vec3f> normals = {};
+		std::vector<i32> normal_ws = {};
+		std::vector<vec4f> bitangents = {};
+		std::vector<std::vector<vec3f>> uvs = {}; //one array per channel
+		std::vector<std::vector<vec4f>> tangents = {};
+		std::vector<std::vector<vertex_color_t>> colors = {};
+
+		vertex_arrays_t() = default;
+
+		vertex_arrays_t(i64 count_) : count(count_) {};
+
+		bool has(u32 attribute) const {return (attributes & attribute) == attribute;};
+
+		//sizes the arrays for attribute, zeroed, if it isn't there yet
+		void add(u32 attribute)
+		{
+			if(has(attribute))
+				return;
+			attributes |= attribute;
+			if(attribute & VA_POSITION)
+				positions.assign(count,{});
+			if(attribute & VA_BONE_WEIGHTS)
+				bone_weights.assign(count,{});
+			if(attribute & VA_BONE_INDICES)
+				bone_indices.assign(count,{});
+			if(attribute & VA_NORMAL)
+			{
+				normals.assign(count,{});
+				normal_ws.assign(count,0);
+			}
+			if(attribute & VA_BITANGENT)
+				bitangents.assign(count,{});
+		};
+
+		//adds n channels, returns the index of the first
+		template <typename T>
+		static i32 add_channels(std::vector<std::vector<T>>& channels, i32 n, i64 count)
+		{
+			i32 first = channels.size();
+			for(i32 i = 0; i < n; i++)
+				channels.emplace_back(count);
+			return first;
+		};
+
+		i32 add_uvs(i32 n) {return add_channels(uvs,n,count);};
+
+		i32 add_tangents(i32 n) {return add_channels(tangents,n,count);};
+
+		i32 add_colors(i32 n) {return add_channels(colors,n,count);};
+
+		//copies vertex i into v, appending to its uvs, tangents and colors
+		void copy_to(i64 i, vertex_t& v) const
+		{
+			if(has(VA_POSITION))
+				v.position = positions[i];
+			if(has(VA_BONE_WEIGHTS))
+				v.bone_weights = bone_weights[i];
+			if(has(VA_BONE_INDICES))
+				v.bone_indices = bone_indices[i];
+			if(has(VA_NORMAL))
+			{
+				v.normal = normals[i];
+				v.normal_w = normal_ws[i];
+			}
+			if(has(VA_BITANGENT))
+				v.bitangent = bitangents[i];
+			for(const std::vector<vec3f>& uv : uvs)
+				v.uvs.push_back(uv[i]);
+			for(const std::vector<vec4f>& tangent : tangents)
+				v.tangents.push_back(tangent[i]);
+			for(const std::vector<vertex_color_t>& color : colors)
+				v.colors.push_back(color[i]);
+		};
+
+		//moves vertex i to remap[i] in every array, remap being a permutation
+		void remap(const std::vector<u32>& remap)
+		{
+			auto apply = [&](auto& array)
+			{
+				if(array.empty())
+					return;
+				std::remove_reference_t<decltype(array)> moved(array.size());
+				for(i64 i = 0; i < count; i++)
+					moved[remap[i]] = array[i];
+				array = std::move(moved);
+			};
+			apply(positions);
+			apply(bone_weights);
+			apply(bone_indices);
+			apply(normals);
+			apply(normal_ws);
+			apply(bitangents);
+			for(std::vector<vec3f>& uv : uvs)
+				apply(uv);
+			for(std::vector<vec4f>& tangent : tangents)
+				apply(tangent);
+			for(std::vector<vertex_color_t>& color : colors)
+				apply(color);
+		};
+
+		vertex_t vertex(i64 i) const
+		{
+			vertex_t v = {};
+			copy_to(i,v);
+			return v;
+		};
+
+		std::vector<vertex_t> to_vertices() const
+		{
+			std::vector<vertex_t> out(count);
+			for(i64 i = 0; i < count; i++)
+				copy_to(i,out[i]);
+			return out;
+		};
+	};
+};
+
+#include "vertex_plan.h"
\ No newline at end of file
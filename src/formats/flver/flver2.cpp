@@ -1,14 +1,249 @@
 #include "flver2.h"
+#include <algorithm>
 
 flver2_t::flver2_t() : file_t(FILE_FLVER2) {};
 
+static std::string read_string(UMEM* mem, const flver2_t::header_t& header, i32 offset)
+{
+	if(header.unicode)
+		return mem->read_utf16(offset);
+	return mem->read_shift_jis(offset);
+};
+
+static std::vector<i32> read_i32s(UMEM* mem, i32 offset, i32 count)
+{
+	std::vector<i32> v(count);
+	if(count <= 0)
+		return v;
+	mem->step_in(offset);
+	for(i32 i = 0; i < count; i++)
+		v[i] = mem->read_i32();
+	mem->step_out();
+	return v;
+};
+
+//size bytes at position without moving the cursor, in place for memory backed UMEMs
+static const u8* read_span(UMEM* mem, i64 position, i64 size, std::vector<u8>& scratch)
+{
+	const u8* p = mem->view(position,size);
+	if(p != nullptr)
+		return p;
+	scratch.resize(size);
+	if(mem->read_at(scratch.data(),size,position) != size)
+		throw std::runtime_error("flver2_t data past the end of the file!\n");
+	return scratch.data();
+};
+
+sp<flver2_t::texture_t> flver2_t::texture_t::create(UMEM* mem, const header_t& header)
+{
+	sp<texture_t> tex = std::make_shared<texture_t>();
+	tex->read(mem,header);
+	return tex;
+};
+
+void flver2_t::texture_t::read(UMEM* mem, const header_t& header)
+{
+	i32 path_offset = mem->read_i32();
+	i32 type_offset = mem->read_i32();
+	scale = mem->read_v2f();
+	unk10 = mem->read_u8();
+	unk11 = mem->read_u8();
+	mem->assert_u8(0);
+	mem->assert_u8(0);
+	unk14 = mem->read_f32();
+	unk18 = mem->read_f32();
+	unk1c = mem->read_f32();
+
+	path = read_string(mem,header,path_offset);
+	type = read_string(mem,header,type_offset);
+};
+
+sp<flver2_t::faceset_t> flver2_t::faceset_t::create(UMEM* mem, const header_t& header, i32 header_index_size)
+{
+	sp<faceset_t> fs = std::make_shared<faceset_t>();
+	fs->read(mem,header,header_index_size);
+	return fs;
+};
+
+void flver2_t::faceset_t::read(UMEM* mem, const header_t& header, i32 header_index_size)
+{
+	flags = mem->read_u32();
+	tri_strip = mem->read_u8();
+	cull_backfaces = mem->read_u8();
+	unk06 = mem->read_u16();
+	index_count = mem->read_i32();
+	indices_offset = mem->read_i32();
+
+	index_size = 0;
+	if(header.version > 0x20005)
+	{
+		mem->read_i32(); //indices length
+		mem->assert_i32(0);
+		index_size = mem->read_i32();
+		mem->assert_i32(0);
+	}
+	if(index_size == 0)
+		index_size = header_index_size;
+};
+
+sp<flver2_t::mesh_t> flver2_t::mesh_t::create(UMEM* mem, const header_t& header)
+{
+	sp<mesh_t> mesh = std::make_shared<mesh_t>();
+	mesh->read(mem,header);
+	return mesh;
+};
+
+void flver2_t::mesh_t::read(UMEM* mem, const header_t& header)
+{
+	dynamic = mem->read_u8();
+	for(i32 i = 0; i < 3; i++)
+		mem->assert_u8(0);
+	material_index = mem->read_i32();
+	mem->assert_i32(0);
+	mem->assert_i32(0);
+	default_bone_index = mem->read_i32();
+	i32 bone_count = mem->read_i32();
+	i32 bounding_box_offset = mem->read_i32();
+	i32 bone_offset = mem->read_i32();
+	i32 faceset_count = mem->read_i32();
+	i32 faceset_offset = mem->read_i32();
+	i32 vertex_buffer_count = mem->read_i32();
+	i32 vertex_buffer_offset = mem->read_i32();
+
+	has_bounding_box = bounding_box_offset != 0;
+	if(has_bounding_box)
+	{
+		mem->step_in(bounding_box_offset);
+		bounding_box.min = mem->read_v3f();
+		bounding_box.max = mem->read_v3f();
+		if(header.version >= 0x2001A)
+			bounding_box.unk = mem->read_v3f();
+		mem->step_out();
+	}
+
+	bone_indices = read_i32s(mem,bone_offset,bone_count);
+	faceset_indices = read_i32s(mem,faceset_offset,faceset_count);
+	vertex_buffer_indices = read_i32s(mem,vertex_buffer_offset,vertex_buffer_count);
+};
+
+sp<flver2_t::material_t> flver2_t::material_t::create(UMEM* mem, const header_t& header,
+	std::vector<sp<gx_list_t>>& gx_lists, umap<i32,i32>& gx_list_indices)
+{
+	sp<material_t> mat = std::make_shared<material_t>();
+	mat->read(mem,header,gx_lists,gx_list_indices);
+	return mat;
+};
+
+void flver2_t::material_t::read(UMEM* mem, const header_t& header,
+	std::vector<sp<gx_list_t>>& gx_lists, umap<i32,i32>& gx_list_indices)
+{
+	i32 name_offset = mem->read_i32();
+	i32 mtd_offset = mem->read_i32();
+	texture_count = mem->read_i32();
+	texture_index = mem->read_i32();
+	flags = mem->read_i32();
+	i32 gx_offset = mem->read_i32();
+	unk18 = mem->read_i32();
+	mem->assert_i32(0);
+
+	name = read_string(mem,header,name_offset);
+	mtd = read_string(mem,header,mtd_offset);
+
+	if(gx_offset == 0)
+	{
+		gx_index = -1;
+		return;
+	}
+
+	if(gx_list_indices.find(gx_offset) == gx_list_indices.end())
+	{
+		mem->step_in(gx_offset);
+		gx_list_indices[gx_offset] = gx_lists.size();
+		gx_lists.push_back(gx_list_t::create(mem,header.version));
+		mem->step_out();
+	}
+	gx_index = gx_list_indices[gx_offset];
+};
+
+sp<flver2_t::vertex_buffer_t> flver2_t::vertex_buffer_t::create(UMEM* mem)
+{
+	sp<vertex_buffer_t> vb = std::make_shared<vertex_buffer_t>();
+	vb->read(mem);
+	return vb;
+};
+
+void flver2_t::vertex_buffer_t::read(UMEM* mem)
+{
+	buffer_index = mem->read_i32();
+	layout_index = mem->read_i32();
+	vertex_size = mem->read_i32();
+	vertex_count = mem->read_i32();
+	mem->assert_i32(0);
+	mem->assert_i32(0);
+	mem->read_i32(); //buffer length
+	buffer_offset = mem->read_i32();
+};
+
+sp<flver2_t::buffer_layout_t> flver2_t::buffer_layout_t::create(UMEM* mem)
+{
+	sp<buffer_layout_t> layout = std::make_shared<buffer_layout_t>();
+	layout->read(mem);
+	return layout;
+};
+
+void flver2_t::buffer_layout_t::read(UMEM* mem)
+{
+	i32 member_count = mem->read_i32();
+	mem->assert_i32(0);
+	mem->assert_i32(0);
+	i32 member_offset = mem->read_i32();
+
+	members.resize(std::max(member_count,0));
+	size = 0;
+	if(members.empty())
+		return;
+
+	mem->step_in(member_offset);
+	for(flver::layout_member_t& member : members)
+	{
+		member.read(mem,size);
+		size += member.size;
+	}
+	mem->step_out();
+};
+
+flver::vertex_plan_t flver2_t::buffer_layout_t::compile() const
+{
+	std::vector<flver::layout_member_t*> layout;
+	for(const flver::layout_member_t& member : members)
+		layout.push_back((flver::layout_member_t*)&member);
+	return flver::vertex_plan_t::compile(layout);
+};
+
 i32 flver2_t::read(UMEM* mem)
 {
-	mem->big_endian() = false;
+	char magic[6];
+	mem->read(magic,sizeof(char),6);
+	if(memcmp(magic,"FLVER\0",6) != 0)
+		throw std::runtime_error("flver2_t::read() bad magic!\n");
 
-	i32 data_offset = mem->read_i32();
-	mem->read_i32();
-	i32 dum_count  = mem->read_i32();	
+	char endian[2];
+	mem->read(endian,sizeof(char),2);
+	if(endian[0] == 'B' && endian[1] == 0)
+		m_header.big_endian = true;
+	else if(endian[0] == 'L' && endian[1] == 0)
+		m_header.big_endian = false;
+	else
+		throw std::runtime_error("flver2_t::read() bad endian marker!\n");
+	mem->big_endian() = m_header.big_endian;
+
+	m_header.version = mem->read_i32();
+	if((m_header.version & 0xFFFF0000) != 0x20000)
+		throw std::runtime_error("flver2_t::read() not a flver2 version: "+std::to_string(m_header.version)+"\n");
+
+	m_data_offset = mem->read_i32();
+	mem->read_i32(); //data length
+	i32 dum_count  = mem->read_i32();
 	i32 mat_count  = mem->read_i32();
 	i32 bone_count = mem->read_i32();
 	i32 mesh_count = mem->read_i32();
@@ -17,11 +252,10 @@ i32 flver2_t::read(UMEM* mem)
 	m_header.bounding_box_min = mem->read_v3f();
 	m_header.bounding_box_max = mem->read_v3f();
 
-	mem->read_i32(); //face count (no blur or degen meshes)
-	mem->read_i32(); //total face count
+	m_header.true_face_count = mem->read_i32();
+	m_header.total_face_count = mem->read_i32();
 
-	i32 vert_idx_size = mem->read_i32();
-	
+	i32 vert_idx_size = mem->read_u8();
 	m_header.unicode = mem->read_u8();
 	m_header.unk4a = mem->read_u8();
 	if(!mem->assert_u8(0))
@@ -37,22 +271,356 @@ i32 flver2_t::read(UMEM* mem)
 	m_header.unk5d = mem->read_u8();
 	for(i32 i = 0; i < 2; i++)
 		if(!mem->assert_u8(0))
-			return 0;
+			return -1;
 	for(i32 i = 0; i < 2; i++)
 		if(!mem->assert_u32(0))
-			return 0;
+			return -1;
 
 	m_header.unk68 = mem->read_i32();
 
 	for(i32 i = 0; i < 5; i++)
 		if(!mem->assert_u32(0))
-			return 0;
+			return -1;
 
 	for(i32 i = 0; i < dum_count; i++)
 		m_dummies.push_back(flver::dummy_t::create(mem,m_header.version));
 
+	umap<i32,i32> gx_list_indices;
 	for(i32 i = 0; i < mat_count; i++)
-		m_materials.push_back(material_t::create(mem,m_header,gx_lists,gx_list_indices));
+		m_materials.push_back(material_t::create(mem,m_header,m_gx_lists,gx_list_indices));
+
+	for(i32 i = 0; i < bone_count; i++)
+		m_bones.push_back(flver::bone_t::create(mem,m_header.unicode));
+
+	for(i32 i = 0; i < mesh_count; i++)
+		m_meshes.push_back(mesh_t::create(mem,m_header));
+
+	for(i32 i = 0; i < face_set_count; i++)
+		m_facesets.push_back(faceset_t::create(mem,m_header,vert_idx_size));
+
+	for(i32 i = 0; i < vbuf_count; i++)
+		m_vertex_buffers.push_back(vertex_buffer_t::create(mem));
 
+	for(i32 i = 0; i < buff_layout_count; i++)
+		m_buffer_layouts.push_back(buffer_layout_t::create(mem));
+
+	for(i32 i = 0; i < tex_count; i++)
+		m_textures.push_back(texture_t::create(mem,m_header));
+
+	//materials and meshes point into the shared tables by index
+	for(sp<material_t>& mat : m_materials)
+	{
+		if(mat->texture_index < 0 || mat->texture_count < 0 || mat->texture_index + mat->texture_count > m_textures.size())
+			throw std::runtime_error("flver2_t::read() material texture out of range!\n");
+		for(i32 i = 0; i < mat->texture_count; i++)
+			mat->textures.push_back(m_textures[mat->texture_index+i].get());
+	}
+
+	for(sp<mesh_t>& mesh : m_meshes)
+	{
+		for(i32 i : mesh->faceset_indices)
+			mesh->facesets.push_back(m_facesets.at(i).get());
+		for(i32 i : mesh->vertex_buffer_indices)
+		{
+			vertex_buffer_t* vb = m_vertex_buffers.at(i).get();
+			if(vb->layout_index < 0 || vb->layout_index >= m_buffer_layouts.size())
+				throw std::runtime_error("flver2_t::read() vertex buffer layout out of range!\n");
+			mesh->vertex_buffers.push_back(vb);
+		}
+	}
+
+	m_mem = mem;
 	return 0;
+};
+
+//writing isn't supported yet
+i32 flver2_t::write(UMEM* mem)
+{
+	return -1;
+};
+
+flver2_t::mesh_t* flver2_t::mesh(i32 i)
+{
+	mesh_t* mesh = m_meshes.at(i).get();
+	//a throwing load leaves the flag unset, so the next call tries again
+	std::call_once(mesh->load_once,[&]{load(*mesh);});
+	return mesh;
+};
+
+sp<const flver::skeleton_t> flver2_t::skeleton()
+{
+	std::lock_guard<std::mutex> lock(m_skeleton_mutex);
+	if(m_skeleton == nullptr)
+		m_skeleton = std::make_shared<const flver::skeleton_t>(flver::skeleton_t::create(m_bones));
+	return m_skeleton;
+};
+
+void flver2_t::reset_skeleton()
+{
+	std::lock_guard<std::mutex> lock(m_skeleton_mutex);
+	m_skeleton = nullptr;
+};
+
+void flver2_t::load_all(i32 threads)
+{
+	thread_pool_t pool(threads);
+	load_all(pool);
+};
+
+void flver2_t::load_all(thread_pool_t& pool)
+{
+	//bytes of indices and vertices each mesh still has to decode
+	std::vector<std::pair<i64,i32>> pending;
+	for(i32 i = 0; i < m_meshes.size(); i++)
+	{
+		const mesh_t* mesh = m_meshes[i].get();
+		if(mesh->loaded)
+			continue;
+		i64 bytes = 0;
+		for(const faceset_t* fs : mesh->facesets)
+			bytes += (i64)fs->index_count * fs->index_size / 8;
+		for(const vertex_buffer_t* vb : mesh->vertex_buffers)
+			bytes += (i64)vb->vertex_count * vb->vertex_size;
+		pending.push_back({bytes,i});
+	}
+	std::sort(pending.begin(),pending.end(),[](const auto& a, const auto& b){return a.first > b.first;});
+
+	pool.parallel_for(pending.size(),[&](i64 i)
+	{
+		mesh(pending[i].second);
+	});
+};
+
+flver::triangles_t flver2_t::triangulate(i32 i, i32 j, bool degenerates)
+{
+	mesh_t* m = mesh(i);
+	const faceset_t* fs = m->facesets.at(j);
+	return flver::triangulate(fs->indices,fs->tri_strip,m->vertices.count < flver::STRIP_RESTART,degenerates);
+};
+
+bool flver2_t::check_face_counts(i64* true_faces, i64* total_faces)
+{
+	thread_pool_t pool;
+	load_all(pool);
+
+	std::vector<std::pair<i32,i32>> sets;
+	for(i32 i = 0; i < m_meshes.size(); i++)
+		for(i32 j = 0; j < m_meshes[i]->facesets.size(); j++)
+			sets.push_back({i,j});
+
+	std::atomic<i64> true_count = 0;
+	std::atomic<i64> total_count = 0;
+	pool.parallel_for(sets.size(),[&](i64 k)
+	{
+		auto [i,j] = sets[k];
+		const faceset_t* fs = m_meshes[i]->facesets[j];
+		flver::triangles_t tris = triangulate(i,j,true);
+		total_count += tris.total_faces;
+		//lists count every face as true, as the games write them
+		if(!fs->tri_strip)
+			true_count += tris.total_faces;
+		else if(!(fs->flags & faceset_t::FS_MOTION_BLUR))
+			true_count += tris.total_faces - tris.degenerates;
+	});
+
+	if(true_faces != nullptr)
+		*true_faces = true_count;
+	if(total_faces != nullptr)
+		*total_faces = total_count;
+	return true_count == m_header.true_face_count && total_count == m_header.total_face_count;
+};
+
+void flver2_t::optimize(i32 i, const flver::optimize_options_t& opts)
+{
+	mesh_t* m = mesh(i);
+	i64 vertex_count = m->vertices.count;
+	bool restarts = vertex_count < flver::STRIP_RESTART;
+
+	std::vector<std::vector<u32>> lists(m->facesets.size());
+	for(i32 j = 0; j < m->facesets.size(); j++)
+	{
+		flver::triangles_t tris = triangulate(i,j);
+		if(tris.wide)
+			lists[j] = std::move(tris.indices32);
+		else
+			lists[j].assign(tris.indices16.begin(),tris.indices16.end());
+
+		for(u32 index : lists[j])
+			if(index >= vertex_count)
+				throw std::runtime_error("flver2_t::optimize() index past the mesh's vertices!\n");
+	}
+
+	if(opts.vertex_cache)
+		for(std::vector<u32>& list : lists)
+			flver::optimize_vertex_cache(list.data(),list.size(),vertex_count);
+
+	if(opts.vertex_fetch)
+	{
+		std::vector<std::vector<u32>*> ptrs;
+		for(std::vector<u32>& list : lists)
+			ptrs.push_back(&list);
+		m->vertices.remap(flver::optimize_vertex_fetch(ptrs,vertex_count));
+	}
+
+	for(i32 j = 0; j < m->facesets.size(); j++)
+	{
+		faceset_t* fs = m->facesets[j];
+		if(fs->tri_strip && opts.strips)
+			lists[j] = flver::stripify(lists[j].data(),lists[j].size(),restarts);
+		else
+			fs->tri_strip = false;
+		fs->indices.assign(lists[j].begin(),lists[j].end());
+		fs->index_count = fs->indices.size();
+	}
+};
+
+void flver2_t::update_bounds(i32 threads)
+{
+	thread_pool_t pool(threads);
+	update_bounds(pool);
+};
+
+void flver2_t::update_bounds(thread_pool_t& pool)
+{
+	load_all(pool);
+
+	sp<const flver::skeleton_t> skeleton = this->skeleton();
+	i32 bone_count = m_bones.size();
+
+	std::mutex mutex;
+	bounding_box_t model = flver::empty_bounds();
+	std::vector<bounding_box_t> bone_boxes(bone_count,flver::empty_bounds());
+	std::vector<bool> weighted(bone_count,false);
+
+	pool.parallel_for(m_meshes.size(),[&](i64 i)
+	{
+		mesh_t* mesh = m_meshes[i].get();
+		const flver::vertex_arrays_t& v = mesh->vertices;
+		if(!v.has(flver::vertex_arrays_t::VA_POSITION) || v.count == 0)
+			return;
+
+		bounding_box_t box = flver::bounds(v.positions.data(),v.count);
+		if(mesh->has_bounding_box)
+		{
+			mesh->bounding_box.min = box.min;
+			mesh->bounding_box.max = box.max;
+		}
+
+		//vertices per bone, through the mesh's bone table where it has one
+		auto global = [&](i32 local)
+		{
+			if(!mesh->bone_indices.empty())
+				return local >= 0 && local < mesh->bone_indices.size() ? mesh->bone_indices[local] : -1;
+			return local;
+		};
+		std::vector<std::vector<u32>> per_bone(bone_count);
+		for(i64 k = 0; k < v.count; k++)
+		{
+			for(i32 j = 0; j < 4; j++)
+			{
+				i32 b;
+				if(v.has(flver::vertex_arrays_t::VA_BONE_WEIGHTS))
+				{
+					if(v.bone_weights[k][j] <= 0.0f)
+						continue;
+					b = global(v.bone_indices.empty() ? 0 : v.bone_indices[k][j]);
+				}
+				else
+				{
+					//unweighted vertices follow their first bone, or the mesh's default one
+					if(j > 0)
+						break;
+					b = v.has(flver::vertex_arrays_t::VA_BONE_INDICES) ? global(v.bone_indices[k][0]) : mesh->default_bone_index;
+				}
+				if(b >= 0 && b < bone_count && (per_bone[b].empty() || per_bone[b].back() != k))
+					per_bone[b].push_back(k);
+			}
+		}
+
+		std::vector<vec3f> local;
+		std::vector<std::pair<i32,bounding_box_t>> boxes;
+		for(i32 b = 0; b < bone_count; b++)
+		{
+			if(per_bone[b].empty())
+				continue;
+			local.resize(per_bone[b].size());
+			for(i64 k = 0; k < local.size(); k++)
+				local[k] = v.positions[per_bone[b][k]];
+			transform_points(skeleton->inverse_world(b),local.data(),local.data(),local.size());
+			boxes.push_back({b,flver::bounds(local.data(),local.size())});
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		flver::grow(model,box);
+		for(auto& [b,bone_box] : boxes)
+		{
+			flver::grow(bone_boxes[b],bone_box);
+			weighted[b] = true;
+		}
+	});
+
+	if(model.min.x <= model.max.x)
+	{
+		m_header.bounding_box_min = model.min;
+		m_header.bounding_box_max = model.max;
+	}
+	for(i32 b = 0; b < bone_count; b++)
+	{
+		if(!weighted[b])
+			continue;
+		m_bones[b]->bounding_box_min = bone_boxes[b].min;
+		m_bones[b]->bounding_box_max = bone_boxes[b].max;
+	}
+};
+
+void flver2_t::load(mesh_t& mesh)
+{
+	if(m_mem == nullptr)
+		throw std::runtime_error("flver2_t::load() nothing read!\n");
+
+	bool be = m_header.big_endian;
+	std::vector<u8> scratch;
+
+	for(faceset_t* fs : mesh.facesets)
+	{
+		i64 position = (i64)m_data_offset + fs->indices_offset;
+		i64 count = std::max(fs->index_count,0);
+		fs->indices.resize(count);
+		if(fs->index_size == 16)
+		{
+			const u8* src = read_span(m_mem,position,count*2,scratch);
+			for(i64 j = 0; j < count; j++)
+			{
+				u16 u;
+				memcpy(&u,src+j*2,2);
+				fs->indices[j] = be ? __builtin_bswap16(u) : u;
+			}
+		}
+		else if(fs->index_size == 32)
+		{
+			const u8* src = read_span(m_mem,position,count*4,scratch);
+			memcpy(fs->indices.data(),src,count*4);
+			if(be)
+				for(i32& index : fs->indices)
+					index = __builtin_bswap32(index);
+		}
+		else
+		{
+			//8 is edge compressed, which only ps3 files use
+			throw std::runtime_error("flver2_t::load() unsupported index size: "+std::to_string(fs->index_size)+"\n");
+		}
+	}
+
+	//every buffer of a mesh holds the same vertices, each with some of the attributes
+	i64 count = mesh.vertex_buffers.empty() ? 0 : mesh.vertex_buffers[0]->vertex_count;
+	flver::vertex_arrays_t vertices(count);
+	for(vertex_buffer_t* vb : mesh.vertex_buffers)
+	{
+		flver::vertex_plan_t plan = m_buffer_layouts[vb->layout_index]->compile();
+		if(vb->vertex_count != count)
+			throw std::runtime_error("flver2_t::load() mesh buffers differ in vertex count!\n");
+		plan.decode_at(m_mem,(i64)m_data_offset + vb->buffer_offset,vb->vertex_size,vertices,uv_factor(),be);
+	}
+	mesh.vertices = std::move(vertices);
+	mesh.loaded = true;
 };
\ No newline at end of file
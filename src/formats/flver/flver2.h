@@ -1,9 +1,25 @@
 #pragma once
 #include "../file.h"
 #include "flver.h"
+#include "bounds.h"
+#include "optimize.h"
+#include "skeleton.h"
+#include "triangulate.h"
+#include "../../util/thread_pool.h"
+#include <atomic>
+#include <mutex>
 
+/*
+	read() parses the header and every small table (dummies, materials,
+	bones, meshes, face sets, vertex buffers, layouts and textures) but
+	only records where each face set's indices and each buffer's vertices
+	live. a mesh's geometry is decoded the first time mesh() hands it out,
+	so bounding boxes and material lists cost no vertex decoding at all.
+	the UMEM given to read() has to outlive every mesh() call
+*/
 class flver2_t : public file_t
 {
+	public:
 	struct header_t
 	{
 		bool big_endian = false;
@@ -16,6 +32,8 @@ class flver2_t : public file_t
 		u8  unk5c = 0;
 		u8  unk5d = 0;
 		u32 unk68 = 0;
+		i32 true_face_count = 0;  //no motion blur or degenerate faces
+		i32 total_face_count = 0;
 
 		header_t()
 		{
@@ -39,15 +57,36 @@ class flver2_t : public file_t
 		float unk14;
 		float unk18;
 		float unk1c;
+
+		static sp<texture_t> create(UMEM* mem, const header_t& header);
+
+		void read(UMEM* mem, const header_t& header);
 	};
 
 	struct faceset_t
 	{
+		enum flags_e : u32
+		{
+			FS_LOD_LEVEL1      = 0x01000000,
+			FS_LOD_LEVEL2      = 0x02000000,
+			FS_EDGE_COMPRESSED = 0x40000000,
+			FS_MOTION_BLUR     = 0x80000000,
+		};
+
 		u32 flags;
 		bool tri_strip;
 		bool cull_backfaces;
 		u16 unk06;
 		std::vector<i32> indices = {};
+
+		//where the indices live, filled in when the owning mesh loads
+		i32 index_count;
+		i32 indices_offset; //from the header's data offset
+		i32 index_size;     //bits, 8 is edge compressed
+
+		static sp<faceset_t> create(UMEM* mem, const header_t& header, i32 header_index_size);
+
+		void read(UMEM* mem, const header_t& header, i32 header_index_size);
 	};
 
 	struct vertex_buffer_t;
@@ -60,24 +99,42 @@ class flver2_t : public file_t
 		std::vector<i32> bone_indices = {};
 		std::vector<faceset_t*> facesets = {};
 		std::vector<vertex_buffer_t*> vertex_buffers = {};
-		std::vector<flver::vertex_t> vertices = {};
+		flver::vertex_arrays_t vertices = {};
 
+		bool has_bounding_box = false;
 		bounding_box_t bounding_box;
 
 		std::vector<i32> faceset_indices = {};
 		std::vector<i32> vertex_buffer_indices = {};
+
+		//set once vertices and face set indices are decoded
+		std::atomic<bool> loaded = false;
+		std::once_flag load_once;
+
+		static sp<mesh_t> create(UMEM* mem, const header_t& header);
+
+		void read(UMEM* mem, const header_t& header);
 	};
 
+	struct gx_list_t;
+
 	struct material_t
 	{
 		std::string name;
 		std::string mtd;
-		i32 falgs;
+		i32 flags;
 		std::vector<texture_t*> textures = {};
 		i32 gx_index;
 		i32 unk18;
 		i32 texture_index;
 		i32 texture_count;
+
+		//gx lists are shared between materials, gx_list_indices maps their offsets to gx_lists
+		static sp<material_t> create(UMEM* mem, const header_t& header,
+			std::vector<sp<gx_list_t>>& gx_lists, umap<i32,i32>& gx_list_indices);
+
+		void read(UMEM* mem, const header_t& header,
+			std::vector<sp<gx_list_t>>& gx_lists, umap<i32,i32>& gx_list_indices);
 	};
 
 	struct vertex_buffer_t
@@ -86,20 +143,31 @@ class flver2_t : public file_t
 		i32 vertex_size;
 		i32 buffer_index;
 		i32 vertex_count;
-		i32 buffer_offset;
+		i32 buffer_offset; //from the header's data offset
+
+		static sp<vertex_buffer_t> create(UMEM* mem);
+
+		void read(UMEM* mem);
 	};
 
 	struct buffer_layout_t
 	{
-		i32 size;
+		std::vector<flver::layout_member_t> members = {};
+		i32 size = 0;
+
+		static sp<buffer_layout_t> create(UMEM* mem);
+
+		void read(UMEM* mem);
+
+		//throws on members the vertex decoder doesn't know
+		flver::vertex_plan_t compile() const;
 	};
 
 	struct gx_item_t
 	{
 		std::string id = "0";
 		i32 unk04 = 100;
-		u8* data = nullptr;
-		i32 length = 0;
+		std::vector<u8> data = {};
 
 		void read(UMEM* mem, i32 header_version)
 		{
@@ -114,11 +182,11 @@ class flver2_t : public file_t
 			}
 
 			unk04 = mem->read_i32();
-			length = mem->read_i32();
-			if(data != nullptr)
-				delete data;
-			data = new u8[length-0xC];
-			mem->read(data,sizeof(u8),length-0xC);
+			i32 length = mem->read_i32();
+			if(length < 0xC)
+				throw std::runtime_error("flver2_t::gx_item_t bad length!\n");
+			data.resize(length-0xC);
+			mem->read(data.data(),sizeof(u8),data.size());
 		};
 
 		void write(UMEM* mem, i32 header_version)
@@ -133,8 +201,8 @@ class flver2_t : public file_t
 			}
 
 			mem->write_i32(unk04);
-			mem->write_i32(length+0xC);
-			mem->write(data,sizeof(u8),length-0xC);
+			mem->write_i32(data.size()+0xC);
+			mem->write(data.data(),sizeof(u8),data.size());
 		};
 	};
 
@@ -142,11 +210,11 @@ class flver2_t : public file_t
 	{
 		std::vector<sp<gx_item_t>> gx_items = {};
 		i32 terminator_id = INT32_MAX;
-		i32 terminator_length;
+		i32 terminator_length = 0;
 
 		static sp<gx_list_t> create(UMEM* mem, i32 header_version)
 		{
-			sp<gx_list_t> gx = sp<gx_list_t>();
+			sp<gx_list_t> gx = std::make_shared<gx_list_t>();
 			gx->read(mem,header_version);
 			return gx;
 		};
@@ -155,38 +223,56 @@ class flver2_t : public file_t
 		{
 			if(header_version < 0x20010)
 			{
-				sp<gx_item_t> gx = sp<gx_item_t>();
+				sp<gx_item_t> gx = std::make_shared<gx_item_t>();
 				gx->read(mem,header_version);
 				gx_items.push_back(gx);
 			}
 			else
 			{
-				i32 id;
+				//items run until an id of INT32_MAX or -1, peeked before each one
 				while(true)
 				{
-					id = mem->read_i32();
-					if(id != INT32_MAX && id != -1)
-					{
-						sp<gx_item_t> gx = sp<gx_item_t>();
-						gx->read(mem,header_version);
-						gx_items.push_back(gx);
-					}
-					else
+					i32 id = mem->read_i32();
+					if(id == INT32_MAX || id == -1)
 					{
+						terminator_id = id;
 						break;
 					}
+					mem->seek(-4,SEEK_CUR);
+
+					sp<gx_item_t> gx = std::make_shared<gx_item_t>();
+					gx->read(mem,header_version);
+					gx_items.push_back(gx);
 				}
 
-				terminator_id = mem->read_i32();
 				mem->assert_i32(100);
+				terminator_length = mem->read_i32() - 0xC;
+				mem->seek(terminator_length,SEEK_CUR);
 			}
 		};
 	};
 
+	private:
 	header_t m_header;
 	std::vector<sp<flver::dummy_t>> m_dummies = {};
-	std::vector<sp<flver::bone_t>> m_bones = {};
 	std::vector<sp<material_t>> m_materials = {};
+	std::vector<sp<gx_list_t>> m_gx_lists = {};
+	std::vector<sp<flver::bone_t>> m_bones = {};
+	std::vector<sp<mesh_t>> m_meshes = {};
+	std::vector<sp<faceset_t>> m_facesets = {};
+	std::vector<sp<vertex_buffer_t>> m_vertex_buffers = {};
+	std::vector<sp<buffer_layout_t>> m_buffer_layouts = {};
+	std::vector<sp<texture_t>> m_textures = {};
+
+	//built by skeleton() on first use
+	sp<const flver::skeleton_t> m_skeleton = nullptr;
+	std::mutex m_skeleton_mutex;
+
+	//where read() found the file, for loading meshes later
+	UMEM* m_mem = nullptr;
+	i32 m_data_offset = 0;
+
+	void load(mesh_t& mesh);
 
 	public:
 	flver2_t();
@@ -194,4 +280,81 @@ class flver2_t : public file_t
 	i32 read(UMEM* mem);
 
 	i32 write(UMEM* mem);
+
+	const header_t& header() const {return m_header;};
+
+	const std::vector<sp<flver::dummy_t>>& dummies() const {return m_dummies;};
+
+	const std::vector<sp<material_t>>& materials() const {return m_materials;};
+
+	const std::vector<sp<gx_list_t>>& gx_lists() const {return m_gx_lists;};
+
+	const std::vector<sp<flver::bone_t>>& bones() const {return m_bones;};
+
+	const std::vector<sp<texture_t>>& textures() const {return m_textures;};
+
+	/*
+		the bones flattened parents first, with their bind pose world
+		matrices, built on the first call and kept. safe to call from
+		several threads. call reset_skeleton() after editing bones, the
+		skeleton handed out before stays valid for whoever holds it
+	*/
+	sp<const flver::skeleton_t> skeleton();
+
+	void reset_skeleton();
+
+	//uvs are stored as shorts scaled by this
+	float uv_factor() const {return m_header.version >= 0x2000F ? 2048.0f : 1024.0f;};
+
+	i32 mesh_count() const {return m_meshes.size();};
+
+	//mesh i without its geometry, vertices and face set indices may still be empty
+	const mesh_t* mesh_header(i32 i) const {return m_meshes.at(i).get();};
+
+	//mesh i with its geometry, decoded on the first call. safe to call from several threads
+	mesh_t* mesh(i32 i);
+
+	/*
+		decodes every mesh not loaded yet across a thread pool, largest
+		first so one big mesh doesn't finish last on its own. each mesh's
+		face sets and buffers are read positionally, so the meshes don't
+		share a cursor. threads as for thread_pool_t
+	*/
+	void load_all(i32 threads = 0);
+
+	void load_all(thread_pool_t& pool);
+
+	/*
+		face set j of mesh i as a triangle list, loading the mesh if needed.
+		strips restart at 0xFFFF when the mesh has fewer vertices than that
+	*/
+	flver::triangles_t triangulate(i32 i, i32 j, bool degenerates = false);
+
+	/*
+		counts faces the way the header does, loading every mesh: true faces
+		leave out motion blur face sets and degenerate strip triangles.
+		returns whether both match what the header says
+	*/
+	bool check_face_counts(i64* true_faces = nullptr, i64* total_faces = nullptr);
+
+	/*
+		reorders mesh i for drawing, meant to run before writing. face sets
+		are triangulated without degenerates, reordered for the vertex cache,
+		the vertices renumbered in the order the face sets first use them
+		and tri_strip face sets restripped, or turned into lists when
+		opts.strips is off
+	*/
+	void optimize(i32 i, const flver::optimize_options_t& opts = {});
+
+	/*
+		recomputes bounding boxes from the geometry, loading every mesh, so
+		edits don't leave stale bounds behind when writing. meshes that
+		store a box get their positions' bounds, the header the bounds of
+		every mesh, and each bone the bounds of the vertices weighted to it
+		in the bone's own space, taken from skeleton()'s bind pose. bones no
+		vertex is weighted to keep theirs
+	*/
+	void update_bounds(i32 threads = 0);
+
+	void update_bounds(thread_pool_t& pool);
 };
\ No newline at end of file
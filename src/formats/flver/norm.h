@@ -0,0 +1,205 @@
+#pragma once
+#include "../../common.h"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace flver
+{
+	/*
+		bulk conversion of packed normalized integers to floats, for whole
+		vertex buffers at once. every variant produces exactly what the
+		scalar read_*_norm helpers do, biases included, since the vector
+		paths convert through i32 and divide rather than multiply by a
+		reciprocal. big endian input is swapped in the same pass
+	*/
+	enum norm_e
+	{
+		NORM_U8_BIASED,  //(u8 - 127) / 127, as read_u8_norm
+		NORM_U8,         //u8 / 255
+		NORM_I8,         //i8 / 127
+		NORM_I16,        //i16 / 32767, as read_i16_norm
+		NORM_U16_BIASED, //(u16 - 32767) / 32767, as read_u16_norm
+	};
+
+	namespace norm_detail
+	{
+		template <norm_e N>
+		constexpr i32 width() {return N == NORM_I16 || N == NORM_U16_BIASED ? 2 : 1;};
+
+		template <norm_e N>
+		constexpr i32 bias() {return N == NORM_U8_BIASED ? 127 : N == NORM_U16_BIASED ? 32767 : 0;};
+
+		template <norm_e N>
+		constexpr float divisor() {return N == NORM_U8 ? 255.0f : N == NORM_I16 || N == NORM_U16_BIASED ? 32767.0f : 127.0f;};
+
+		//component i of the vertex at p, as the integer the scalar helpers start from
+		template <norm_e N, bool BE>
+		inline i32 load(const u8* p, i32 i)
+		{
+			if constexpr(width<N>() == 1)
+			{
+				return N == NORM_I8 ? (i32)(i8)p[i] : (i32)p[i];
+			}
+			else
+			{
+				u16 u;
+				memcpy(&u,p+i*2,2);
+				if constexpr(BE)
+					u = __builtin_bswap16(u);
+				return N == NORM_I16 ? (i32)(i16)u : (i32)u;
+			}
+		};
+
+		template <norm_e N, bool BE>
+		inline void scalar(const u8* src, i64 count, i64 stride, float* dst, i64 dst_stride, i32 components)
+		{
+			for(i64 i = 0; i < count; i++, src += stride, dst += dst_stride)
+				for(i32 c = 0; c < components; c++)
+					dst[c] = (float)(load<N,BE>(src,c) - bias<N>()) / divisor<N>();
+		};
+
+#ifdef __AVX2__
+		//reverses the bytes of every 16 bit lane
+		inline __m256i swap16(__m256i v)
+		{
+			const __m256i mask = _mm256_setr_epi8(
+				1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14,
+				1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14
+			);
+			return _mm256_shuffle_epi8(v,mask);
+		};
+
+		//eight components already widened to i32, to floats
+		template <norm_e N>
+		inline __m256 finish(__m256i v)
+		{
+			if constexpr(bias<N>() != 0)
+				v = _mm256_sub_epi32(v,_mm256_set1_epi32(bias<N>()));
+			return _mm256_div_ps(_mm256_cvtepi32_ps(v),_mm256_set1_ps(divisor<N>()));
+		};
+
+		//widens the low eight components of v, which hold two vertices
+		template <norm_e N>
+		inline __m256i widen(__m128i v)
+		{
+			if constexpr(N == NORM_I8)
+				return _mm256_cvtepi8_epi32(v);
+			else if constexpr(width<N>() == 1)
+				return _mm256_cvtepu8_epi32(v);
+			else if constexpr(N == NORM_I16)
+				return _mm256_cvtepi16_epi32(v);
+			else
+				return _mm256_cvtepu16_epi32(v);
+		};
+
+		//writes two converted vertices, the first components floats of each
+		inline void store2(float* dst, i64 dst_stride, __m256 v)
+		{
+			_mm_storeu_ps(dst,_mm256_castps256_ps128(v));
+			_mm_storeu_ps(dst+dst_stride,_mm256_extractf128_ps(v,1));
+		};
+#endif
+	};
+
+	/*
+		converts four packed components per vertex, count vertices stride
+		bytes apart, into floats dst_stride floats apart. components is how
+		many of the four are written, 3 for vec3f destinations
+	*/
+	template <norm_e N, bool BE>
+	inline void decode_norm4(const u8* src, i64 count, i64 stride, float* dst, i64 dst_stride, i32 components)
+	{
+		using namespace norm_detail;
+		i64 i = 0;
+#ifdef __AVX2__
+		//vector stores write all four floats. packed vec3fs have the extra
+		//one rewritten by the next vertex and leave the last to the scalar
+		//tail, any other layout with fewer components goes scalar
+		i64 end = 0;
+		if(components == 4 && dst_stride >= 4)
+			end = count;
+		else if(components == 3 && dst_stride == 3)
+			end = count - 1;
+		if(stride <= INT32_MAX / 8)
+		{
+			if constexpr(width<N>() == 1)
+			{
+				const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0,1,2,3,4,5,6,7),_mm256_set1_epi32(stride));
+				for(; i + 8 <= end; i += 8)
+				{
+					__m256i raw = _mm256_i32gather_epi32((const int*)(src + i*stride),offsets,1);
+					__m128i lo = _mm256_castsi256_si128(raw);
+					__m128i hi = _mm256_extracti128_si256(raw,1);
+					float* out = dst + i*dst_stride;
+					store2(out,dst_stride,finish<N>(widen<N>(lo)));
+					store2(out+2*dst_stride,dst_stride,finish<N>(widen<N>(_mm_srli_si128(lo,8))));
+					store2(out+4*dst_stride,dst_stride,finish<N>(widen<N>(hi)));
+					store2(out+6*dst_stride,dst_stride,finish<N>(widen<N>(_mm_srli_si128(hi,8))));
+				}
+			}
+			else
+			{
+				const __m128i offsets = _mm_mullo_epi32(_mm_setr_epi32(0,1,2,3),_mm_set1_epi32(stride));
+				for(; i + 4 <= end; i += 4)
+				{
+					__m256i raw = _mm256_i32gather_epi64((const long long*)(src + i*stride),offsets,1);
+					if constexpr(BE)
+						raw = swap16(raw);
+					float* out = dst + i*dst_stride;
+					store2(out,dst_stride,finish<N>(widen<N>(_mm256_castsi256_si128(raw))));
+					store2(out+2*dst_stride,dst_stride,finish<N>(widen<N>(_mm256_extracti128_si256(raw,1))));
+				}
+			}
+		}
+#endif
+		scalar<N,BE>(src + i*stride,count - i,stride,dst + i*dst_stride,dst_stride,components);
+	};
+
+	/*
+		uvs stored as two i16 per vertex, divided by uv_factor, into vec3f
+		style floats dst_stride apart. z is 0 / uv_factor as vec3f's
+		operator/ leaves it
+	*/
+	template <bool BE>
+	inline void decode_uv_i16(const u8* src, i64 count, i64 stride, float* dst, i64 dst_stride, float uv_factor)
+	{
+		const float z = 0.0f / uv_factor;
+		i64 i = 0;
+#ifdef __AVX2__
+		if(stride <= INT32_MAX / 8)
+		{
+			const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0,1,2,3,4,5,6,7),_mm256_set1_epi32(stride));
+			const __m256 factor = _mm256_set1_ps(uv_factor);
+			for(; i + 8 <= count; i += 8)
+			{
+				__m256i raw = _mm256_i32gather_epi32((const int*)(src + i*stride),offsets,1);
+				if constexpr(BE)
+					raw = norm_detail::swap16(raw);
+				__m256 lo = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(raw))),factor);
+				__m256 hi = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(raw,1))),factor);
+
+				float* out = dst + i*dst_stride;
+				for(__m256 v : {lo,hi})
+				{
+					__m128 a = _mm256_castps256_ps128(v);
+					__m128 b = _mm256_extractf128_ps(v,1);
+					_mm_storel_pi((__m64*)out,a);
+					_mm_storeh_pi((__m64*)(out+dst_stride),a);
+					_mm_storel_pi((__m64*)(out+2*dst_stride),b);
+					_mm_storeh_pi((__m64*)(out+3*dst_stride),b);
+					for(i32 k = 0; k < 4; k++)
+						out[k*dst_stride+2] = z;
+					out += 4*dst_stride;
+				}
+			}
+		}
+#endif
+		for(src += i*stride, dst += i*dst_stride; i < count; i++, src += stride, dst += dst_stride)
+		{
+			dst[0] = (float)norm_detail::load<NORM_I16,BE>(src,0) / uv_factor;
+			dst[1] = (float)norm_detail::load<NORM_I16,BE>(src,1) / uv_factor;
+			dst[2] = z;
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,290 @@
+#pragma once
+#include "../../common.h"
+#include "triangulate.h"
+#include <algorithm>
+#include <cmath>
+
+namespace flver
+{
+	struct optimize_options_t
+	{
+		bool vertex_cache = true; //reorder triangles for the post transform cache
+		bool vertex_fetch = true; //renumber vertices in the order they are first drawn
+		bool strips = true;       //rebuild strips for tri_strip face sets, lists otherwise
+	};
+
+	/*
+		average cache miss ratio of a triangle list on a fifo cache of
+		cache_size vertices: vertices transformed per triangle, 0.5 at best
+		for a regular grid and 3 at worst
+	*/
+	inline float acmr(const u32* indices, i64 count, i32 cache_size = 16)
+	{
+		if(count < 3)
+			return 0.0f;
+		std::vector<u32> fifo(cache_size,UINT32_MAX);
+		i32 head = 0;
+		i64 misses = 0;
+		for(i64 i = 0; i < count; i++)
+		{
+			if(std::find(fifo.begin(),fifo.end(),indices[i]) != fifo.end())
+				continue;
+			misses++;
+			fifo[head] = indices[i];
+			head = (head + 1) % cache_size;
+		}
+		return (float)misses / (float)(count / 3);
+	};
+
+	/*
+		reorders the triangles of a list so consecutive ones reuse recently
+		transformed vertices. Tom Forsyth's linear speed vertex cache
+		optimisation: vertices score by their place in a simulated lru cache
+		and by how few triangles they have left, and the best scoring
+		triangle around the cache is drawn next
+	*/
+	inline void optimize_vertex_cache(u32* indices, i64 count, i64 vertex_count)
+	{
+		const i32 CACHE_SIZE = 32;
+		const float CACHE_DECAY_POWER = 1.5f;
+		const float LAST_TRI_SCORE = 0.75f;
+		const float VALENCE_BOOST_SCALE = 2.0f;
+		const float VALENCE_BOOST_POWER = 0.5f;
+
+		i64 tri_count = count / 3;
+		if(tri_count < 2)
+			return;
+
+		//triangles around each vertex, active ones first
+		std::vector<i32> active(vertex_count,0);
+		for(i64 i = 0; i < tri_count * 3; i++)
+			active[indices[i]]++;
+		std::vector<i64> first(vertex_count + 1,0);
+		for(i64 v = 0; v < vertex_count; v++)
+			first[v+1] = first[v] + active[v];
+		std::vector<i64> adjacency(first[vertex_count]);
+		{
+			std::vector<i64> fill(first.begin(),first.end() - 1);
+			for(i64 i = 0; i < tri_count * 3; i++)
+				adjacency[fill[indices[i]]++] = i / 3;
+		}
+
+		std::vector<i32> cache_pos(vertex_count,-1);
+		std::vector<float> vertex_score(vertex_count);
+		auto score = [&](i64 v)
+		{
+			if(active[v] == 0)
+				return -1.0f;
+			float s = 0.0f;
+			i32 pos = cache_pos[v];
+			if(pos >= 0)
+			{
+				if(pos < 3)
+					s = LAST_TRI_SCORE;
+				else
+					s = std::pow(1.0f - (float)(pos - 3) / (CACHE_SIZE - 3),CACHE_DECAY_POWER);
+			}
+			return s + VALENCE_BOOST_SCALE * std::pow((float)active[v],-VALENCE_BOOST_POWER);
+		};
+		for(i64 v = 0; v < vertex_count; v++)
+			vertex_score[v] = score(v);
+
+		std::vector<float> tri_score(tri_count);
+		std::vector<bool> drawn(tri_count,false);
+		i64 best = 0;
+		for(i64 t = 0; t < tri_count; t++)
+		{
+			tri_score[t] = vertex_score[indices[t*3]] + vertex_score[indices[t*3+1]] + vertex_score[indices[t*3+2]];
+			if(tri_score[t] > tri_score[best])
+				best = t;
+		}
+
+		std::vector<u32> out(tri_count * 3);
+		std::vector<u32> cache;
+		std::vector<u32> next_cache;
+		cache.reserve(CACHE_SIZE + 3);
+		next_cache.reserve(CACHE_SIZE + 3);
+		std::vector<u32> dead_end; //vertices drawn so far, latest last
+		dead_end.reserve(tri_count * 3);
+		i64 scan = 0; //every triangle before this is drawn
+
+		for(i64 n = 0; n < tri_count; n++)
+		{
+			/*
+				nothing around the cache left. the latest drawn vertex with
+				triangles left keeps it local, else the next undrawn triangle
+				in order. neither goes back over what was already passed, so
+				disconnected pieces stay linear
+			*/
+			while(best < 0 && !dead_end.empty())
+			{
+				u32 v = dead_end.back();
+				if(active[v] == 0)
+				{
+					dead_end.pop_back();
+					continue;
+				}
+				best = adjacency[first[v]];
+				for(i32 a = 1; a < active[v]; a++)
+					if(tri_score[adjacency[first[v]+a]] > tri_score[best])
+						best = adjacency[first[v]+a];
+			}
+			if(best < 0)
+			{
+				while(drawn[scan])
+					scan++;
+				best = scan;
+			}
+
+			drawn[best] = true;
+			const u32* tri = indices + best * 3;
+			for(i32 k = 0; k < 3; k++)
+			{
+				u32 v = tri[k];
+				out[n*3+k] = v;
+				dead_end.push_back(v);
+
+				//move best to the end of v's active range and shrink it
+				i64* adj = adjacency.data() + first[v];
+				for(i32 a = 0; a < active[v]; a++)
+				{
+					if(adj[a] == best)
+					{
+						std::swap(adj[a],adj[active[v]-1]);
+						break;
+					}
+				}
+				active[v]--;
+			}
+
+			//the triangle's vertices go to the front of the cache
+			next_cache.assign(tri,tri + 3);
+			for(u32 v : cache)
+				if(v != tri[0] && v != tri[1] && v != tri[2])
+					next_cache.push_back(v);
+
+			for(i32 i = 0; i < next_cache.size(); i++)
+				cache_pos[next_cache[i]] = i < CACHE_SIZE ? i : -1;
+			for(u32 v : next_cache)
+				vertex_score[v] = score(v);
+			if(next_cache.size() > CACHE_SIZE)
+				next_cache.resize(CACHE_SIZE);
+			std::swap(cache,next_cache);
+
+			//rescore the triangles around the cache and pick the best of them
+			best = -1;
+			float best_score = -1.0f;
+			for(u32 v : cache)
+			{
+				for(i32 a = 0; a < active[v]; a++)
+				{
+					i64 t = adjacency[first[v]+a];
+					tri_score[t] = vertex_score[indices[t*3]] + vertex_score[indices[t*3+1]] + vertex_score[indices[t*3+2]];
+					if(tri_score[t] > best_score)
+					{
+						best = t;
+						best_score = tri_score[t];
+					}
+				}
+			}
+		}
+
+		std::copy(out.begin(),out.end(),indices);
+	};
+
+	/*
+		numbers vertices in the order the lists first use them, so fetches
+		walk the vertex buffer forwards. every list is renumbered in place,
+		vertices nothing uses keep their order after the rest. returns the
+		new index of each old vertex
+	*/
+	inline std::vector<u32> optimize_vertex_fetch(std::vector<std::vector<u32>*> lists, i64 vertex_count)
+	{
+		std::vector<u32> remap(vertex_count,UINT32_MAX);
+		u32 next = 0;
+		for(std::vector<u32>* list : lists)
+		{
+			for(u32& i : *list)
+			{
+				if(remap[i] == UINT32_MAX)
+					remap[i] = next++;
+				i = remap[i];
+			}
+		}
+		for(u32& r : remap)
+			if(r == UINT32_MAX)
+				r = next++;
+		return remap;
+	};
+
+	/*
+		strips a triangle list back up, keeping its order and winding. each
+		triangle extends the strip if one of the next few shares the strip's
+		last edge, otherwise a new strip starts: after a STRIP_RESTART when
+		restarts is set, else joined on by degenerate triangles
+	*/
+	inline std::vector<u32> stripify(const u32* indices, i64 count, bool restarts, i32 lookahead = 8)
+	{
+		i64 tri_count = count / 3;
+		std::vector<u32> tris(indices,indices + tri_count * 3);
+		std::vector<u32> strip;
+		strip.reserve(count);
+		i64 start = 0;  //where the current strip starts
+		i64 window = 0; //where its next window starts, for the winding
+
+		//vertex that continues the strip with triangle t, or UINT32_MAX
+		auto extends = [&](const u32* t) -> u32
+		{
+			u32 p = strip[strip.size()-2];
+			u32 q = strip[strip.size()-1];
+			bool flip = (window - start) & 1;
+			for(i32 r = 0; r < 3; r++)
+			{
+				u32 a = t[r], b = t[(r+1)%3], c = t[(r+2)%3];
+				if(!flip && a == p && b == q)
+					return c;
+				if(flip && b == q && c == p)
+					return a;
+			}
+			return UINT32_MAX;
+		};
+
+		for(i64 i = 0; i < tri_count; i++)
+		{
+			const u32* t = tris.data() + i*3;
+			if(!strip.empty())
+			{
+				for(i64 j = i; j < std::min(tri_count,i + lookahead); j++)
+				{
+					u32 x = extends(tris.data() + j*3);
+					if(x == UINT32_MAX)
+						continue;
+					std::swap_ranges(tris.data() + i*3,tris.data() + i*3 + 3,tris.data() + j*3);
+					strip.push_back(x);
+					window++;
+					t = nullptr;
+					break;
+				}
+				if(t == nullptr)
+					continue;
+
+				if(restarts)
+				{
+					strip.push_back(STRIP_RESTART);
+				}
+				else
+				{
+					//degenerates bridge to the next triangle, which must start an even window
+					strip.push_back(strip.back());
+					strip.push_back(t[0]);
+					if(strip.size() & 1)
+						strip.push_back(t[0]);
+				}
+			}
+			strip.insert(strip.end(),t,t + 3);
+			start = strip.size() - 3;
+			window = strip.size() - 2;
+		}
+		return strip;
+	};
+};
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+#include "flver.h"
+#include <stdexcept>
+
+namespace flver
+{
+	/*
+		bones flattened into an array ordered so every parent comes before
+		its children, each subtree contiguous, with the local scale,
+		rotation and translation split into their own arrays. world
+		matrices then come out of one pass down the arrays with no
+		recursion or link chasing. bones whose parent index is out of range
+		are roots. arrays are in skeleton order, slot() and bone() convert
+		to and from the file's bone indices
+	*/
+	struct skeleton_t
+	{
+		std::vector<i32> bones = {};   //bone index of each slot
+		std::vector<i32> slots = {};   //slot of each bone index
+		std::vector<i32> parents = {}; //parent slot of each slot, -1 for roots
+		std::vector<vec3f> translations = {};
+		std::vector<vec3f> rotations = {};
+		std::vector<vec3f> scales = {};
+
+		//bind pose, filled in by create()
+		std::vector<mat4f> worlds = {};
+		std::vector<mat4f> inverse_worlds = {};
+
+		i32 size() const {return bones.size();};
+
+		i32 slot(i32 bone) const {return slots.at(bone);};
+
+		i32 bone(i32 slot) const {return bones.at(slot);};
+
+		const mat4f& world(i32 bone) const {return worlds[slots.at(bone)];};
+
+		//model space to the bone's space
+		const mat4f& inverse_world(i32 bone) const {return inverse_worlds[slots.at(bone)];};
+
+		static skeleton_t create(const std::vector<sp<bone_t>>& src)
+		{
+			skeleton_t s;
+			s.build(src);
+			return s;
+		};
+
+		void build(const std::vector<sp<bone_t>>& src)
+		{
+			i32 count = src.size();
+			auto parent_of = [&](i32 b) -> i32
+			{
+				i32 p = src[b]->parent_index;
+				return p >= 0 && p < count ? p : -1;
+			};
+
+			//children of each bone from the parent indices, the sibling links aren't always kept up
+			std::vector<i32> child_count(count + 1,0);
+			for(i32 b = 0; b < count; b++)
+				child_count[parent_of(b) + 1]++;
+			std::vector<i32> first(count + 2,0);
+			for(i32 b = 0; b <= count; b++)
+				first[b+1] = first[b] + child_count[b];
+			std::vector<i32> children(count);
+			{
+				std::vector<i32> fill(first.begin(),first.end() - 1);
+				for(i32 b = 0; b < count; b++)
+					children[fill[parent_of(b) + 1]++] = b;
+			}
+
+			//depth first from the roots, which sit under the -1 entry
+			bones.clear();
+			bones.reserve(count);
+			std::vector<i32> stack;
+			for(i32 c = first[1] - 1; c >= first[0]; c--)
+				stack.push_back(children[c]);
+			while(!stack.empty())
+			{
+				i32 b = stack.back();
+				stack.pop_back();
+				bones.push_back(b);
+				for(i32 c = first[b+2] - 1; c >= first[b+1]; c--)
+					stack.push_back(children[c]);
+			}
+			//anything never reached hangs off a loop
+			if(bones.size() != count)
+				throw std::runtime_error("flver::skeleton_t::build() bone parents loop!\n");
+
+			slots.assign(count,-1);
+			for(i32 i = 0; i < count; i++)
+				slots[bones[i]] = i;
+			parents.resize(count);
+			translations.resize(count);
+			rotations.resize(count);
+			scales.resize(count);
+			for(i32 i = 0; i < count; i++)
+			{
+				const bone_t& b = *src[bones[i]];
+				i32 p = parent_of(bones[i]);
+				parents[i] = p < 0 ? -1 : slots[p];
+				translations[i] = b.translation;
+				rotations[i] = b.rotation;
+				scales[i] = b.scale;
+			}
+
+			worlds.resize(count);
+			evaluate(worlds.data());
+			inverse_worlds.resize(count);
+			for(i32 i = 0; i < count; i++)
+				inverse_worlds[i] = worlds[i].inverse_affine();
+		};
+
+		/*
+			world matrices of a pose given in skeleton order, size() of each.
+			parents come first, so every parent's world is ready when its
+			children need it
+		*/
+		void evaluate(const vec3f* t, const vec3f* r, const vec3f* s, mat4f* world) const
+		{
+			for(i32 i = 0; i < size(); i++)
+			{
+				world[i] = mat4f::euler_xzy(s[i],r[i],t[i]);
+				if(parents[i] >= 0)
+					world[i] = world[i] * world[parents[i]];
+			}
+		};
+
+		//the bind pose
+		void evaluate(mat4f* world) const
+		{
+			evaluate(translations.data(),rotations.data(),scales.data(),world);
+		};
+	};
+};
\ No newline at end of file
@@ -0,0 +1,212 @@
+#pragma once
+#include "../../common.h"
+#include <algorithm>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace flver
+{
+	//index that restarts a strip, whatever the index size
+	const u32 STRIP_RESTART = 0xFFFF;
+
+	/*
+		a face set as a plain triangle list, in u16 when every index fits
+		below STRIP_RESTART and in u32 otherwise. only one of the vectors is
+		filled. faces are the triangles kept, total_faces every triangle the
+		indices describe (strip restarts excluded, degenerates included)
+	*/
+	struct triangles_t
+	{
+		std::vector<u16> indices16 = {};
+		std::vector<u32> indices32 = {};
+		bool wide = false;
+		i64 faces = 0;
+		i64 total_faces = 0;
+		i64 degenerates = 0;
+
+		i64 size() const {return wide ? indices32.size() : indices16.size();};
+
+		u32 operator[](i64 i) const {return wide ? indices32[i] : indices16[i];};
+	};
+
+	namespace tri_detail
+	{
+		struct emitter_t
+		{
+			u32* out;
+			bool flip = false;
+			bool restarts;
+			bool keep_degenerates;
+			triangles_t& tris;
+
+			void list(u32 a, u32 b, u32 c)
+			{
+				tris.total_faces++;
+				bool degenerate = a == b || b == c || a == c;
+				tris.degenerates += degenerate;
+				if(degenerate && !keep_degenerates)
+					return;
+				*out++ = a;
+				*out++ = b;
+				*out++ = c;
+			};
+
+			//one window of a strip, every other triangle wound the other way
+			void strip(u32 a, u32 b, u32 c)
+			{
+				if(restarts && (a == STRIP_RESTART || b == STRIP_RESTART || c == STRIP_RESTART))
+				{
+					flip = false;
+					return;
+				}
+				if(flip)
+					list(c,b,a);
+				else
+					list(a,b,c);
+				flip = !flip;
+			};
+		};
+
+#ifdef __AVX2__
+		/*
+			unrolls eight strip windows starting at p, if none of them restarts
+			or is a degenerate that gets dropped. returns false to leave the
+			block to the scalar path
+		*/
+		inline bool strip8(const u32* p, emitter_t& e)
+		{
+			__m256i v0 = _mm256_loadu_si256((const __m256i*)p);
+			__m256i v1 = _mm256_loadu_si256((const __m256i*)(p+1));
+			__m256i v2 = _mm256_loadu_si256((const __m256i*)(p+2));
+
+			__m256i bad = _mm256_setzero_si256();
+			if(e.restarts)
+			{
+				__m256i r = _mm256_set1_epi32(STRIP_RESTART);
+				bad = _mm256_or_si256(_mm256_cmpeq_epi32(v0,r),_mm256_cmpeq_epi32(v1,r));
+				bad = _mm256_or_si256(bad,_mm256_cmpeq_epi32(v2,r));
+			}
+			__m256i degenerate = _mm256_or_si256(_mm256_cmpeq_epi32(v0,v1),_mm256_cmpeq_epi32(v1,v2));
+			degenerate = _mm256_or_si256(degenerate,_mm256_cmpeq_epi32(v0,v2));
+			if(!e.keep_degenerates)
+				bad = _mm256_or_si256(bad,degenerate);
+			if(!_mm256_testz_si256(bad,bad))
+				return false;
+
+			//flipped windows swap their first and last index
+			__m256i flip = e.flip ? _mm256_setr_epi32(-1,0,-1,0,-1,0,-1,0) : _mm256_setr_epi32(0,-1,0,-1,0,-1,0,-1);
+			__m256i a = _mm256_blendv_epi8(v0,v2,flip);
+			__m256i c = _mm256_blendv_epi8(v2,v0,flip);
+
+			//8 triangles of a, b, c lanes to 24 interleaved indices
+			a = _mm256_permutevar8x32_epi32(a,_mm256_setr_epi32(0,3,6,1,4,7,2,5));
+			__m256i b = _mm256_permutevar8x32_epi32(v1,_mm256_setr_epi32(5,0,3,6,1,4,7,2));
+			c = _mm256_permutevar8x32_epi32(c,_mm256_setr_epi32(2,5,0,3,6,1,4,7));
+			__m256i* out = (__m256i*)e.out;
+			_mm256_storeu_si256(out,_mm256_blend_epi32(_mm256_blend_epi32(a,b,0x92),c,0x24));
+			_mm256_storeu_si256(out+1,_mm256_blend_epi32(_mm256_blend_epi32(a,b,0x24),c,0x49));
+			_mm256_storeu_si256(out+2,_mm256_blend_epi32(_mm256_blend_epi32(a,b,0x49),c,0x92));
+			e.out += 24;
+
+			e.tris.total_faces += 8;
+			e.tris.degenerates += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(degenerate)));
+			return true;
+		};
+#endif
+
+		inline u32 max_index(const u32* p, i64 n)
+		{
+			u32 m = 0;
+			i64 i = 0;
+#ifdef __AVX2__
+			__m256i vm = _mm256_setzero_si256();
+			for(; i + 8 <= n; i += 8)
+				vm = _mm256_max_epu32(vm,_mm256_loadu_si256((const __m256i*)(p+i)));
+			u32 lanes[8];
+			_mm256_storeu_si256((__m256i*)lanes,vm);
+			for(u32 l : lanes)
+				m = std::max(m,l);
+#endif
+			for(; i < n; i++)
+				m = std::max(m,p[i]);
+			return m;
+		};
+
+		//only for indices that fit in 16 bits
+		inline void narrow(const u32* src, i64 n, u16* dst)
+		{
+			i64 i = 0;
+#ifdef __AVX2__
+			for(; i + 16 <= n; i += 16)
+			{
+				__m256i lo = _mm256_loadu_si256((const __m256i*)(src+i));
+				__m256i hi = _mm256_loadu_si256((const __m256i*)(src+i+8));
+				__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo,hi),0xD8);
+				_mm256_storeu_si256((__m256i*)(dst+i),packed);
+			}
+#endif
+			for(; i < n; i++)
+				dst[i] = src[i];
+		};
+	};
+
+	/*
+		turns count indices into a triangle list. strips are unrolled with
+		every other triangle flipped, as the strip winds, and restart at
+		STRIP_RESTART when restarts is set. degenerate triangles are dropped
+		unless degenerates is set. with AVX2 strips go eight windows at a time
+		wherever a block has nothing to drop
+	*/
+	inline triangles_t triangulate(const i32* indices, i64 count, bool strip, bool restarts = true, bool degenerates = false)
+	{
+		triangles_t tris;
+		const u32* src = (const u32*)indices;
+		i64 windows = strip ? std::max<i64>(count - 2,0) : count / 3;
+		tris.indices32.resize(windows * 3);
+
+		tri_detail::emitter_t e = {tris.indices32.data(),false,restarts,degenerates,tris};
+		if(strip)
+		{
+			i64 i = 0;
+#ifdef __AVX2__
+			//the last block reads up to src[i+9]
+			while(i + 10 <= count)
+			{
+				if(tri_detail::strip8(src+i,e))
+				{
+					i += 8;
+					continue;
+				}
+				for(i64 end = i + 8; i < end; i++)
+					e.strip(src[i],src[i+1],src[i+2]);
+			}
+#endif
+			for(; i < windows; i++)
+				e.strip(src[i],src[i+1],src[i+2]);
+		}
+		else
+		{
+			for(i64 i = 0; i < windows; i++)
+				e.list(src[i*3],src[i*3+1],src[i*3+2]);
+		}
+
+		i64 n = e.out - tris.indices32.data();
+		tris.indices32.resize(n);
+		tris.faces = n / 3;
+
+		tris.wide = tri_detail::max_index(tris.indices32.data(),n) >= STRIP_RESTART;
+		if(!tris.wide)
+		{
+			tris.indices16.resize(n);
+			tri_detail::narrow(tris.indices32.data(),n,tris.indices16.data());
+			tris.indices32 = {};
+		}
+		return tris;
+	};
+
+	inline triangles_t triangulate(const std::vector<i32>& indices, bool strip, bool restarts = true, bool degenerates = false)
+	{
+		return triangulate(indices.data(),indices.size(),strip,restarts,degenerates);
+	};
+};
\ No newline at end of file
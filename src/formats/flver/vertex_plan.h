@@ -0,0 +1,454 @@
+#pragma once
+#include "flver.h"
+#include "norm.h"
+
+namespace flver
+{
+	/*
+		a buffer layout compiled into a flat list of ops, one per member,
+		each knowing where in the vertex it reads from and what it fills in.
+		the layout is resolved once per buffer rather than once per vertex,
+		and each op then runs down the whole buffer filling one attribute
+		array of a vertex_arrays_t.
+		LOT_SHORT2_TO_FLOAT2 shares its value with LOT_BYTE4B and so decodes
+		as LOT_BYTE4B, the branch the old if/else chains always matched first
+	*/
+	class vertex_plan_t
+	{
+		enum op_e : u8
+		{
+			OP_POSITION_F3,
+			OP_POSITION_F4,
+			OP_POSITION_EDGE,
+			OP_WEIGHTS_S8,
+			OP_WEIGHTS_U8,
+			OP_WEIGHTS_S16,
+			OP_INDICES_U8,
+			OP_INDICES_U16,
+			OP_NORMAL_F3,
+			OP_NORMAL_F4,
+			OP_NORMAL_U8,
+			OP_NORMAL_S16,
+			OP_NORMAL_U16,
+			OP_UV_F2,
+			OP_UV_F3,
+			OP_UV_F4,
+			OP_UV_S16,
+			OP_UV_S16_PAIR,
+			OP_UV_S16X3,
+			OP_TANGENT_F4,
+			OP_TANGENT_U8,
+			OP_TANGENT_S16,
+			OP_BITANGENT_U8,
+			OP_COLOR_F4,
+			OP_COLOR_U8,
+		};
+
+		struct op_t
+		{
+			op_e code;
+			i32 offset; //from the start of the vertex
+		};
+
+		std::vector<op_t> m_ops = {};
+		i32 m_size = 0;   //bytes the layout covers
+		i32 m_uvs = 0;    //uvs each vertex gets, for reserving
+		i32 m_tangents = 0;
+		i32 m_colors = 0;
+		bool m_edge = false;
+
+		[[noreturn]] static void unknown(const layout_member_t* member, const char* what)
+		{
+			printf("member semantic: %x\n",member->semantic);
+			printf("member type: %x\n",member->type);
+			throw std::runtime_error(std::string("flver::vertex_t unknown member ")+what+"!\n");
+		};
+
+		//the op for one member, which reads layout_type_size(member->type) bytes
+		static op_t compile(const layout_member_t* member)
+		{
+			switch(member->semantic)
+			{
+				case(LOS_POSITION):
+					switch(member->type)
+					{
+						case(LOT_FLOAT3): return {OP_POSITION_F3};
+						case(LOT_FLOAT4): return {OP_POSITION_F4};
+						case(LOT_EDGE_COMPRESSED): return {OP_POSITION_EDGE};
+					}
+					break;
+				case(LOS_BONE_WEIGHTS):
+					switch(member->type)
+					{
+						case(LOT_BYTE4A): return {OP_WEIGHTS_S8};
+						case(LOT_BYTE4C): return {OP_WEIGHTS_U8};
+						case(LOT_UV_PAIR):
+						case(LOT_SHORT4_TO_FLOAT4A): return {OP_WEIGHTS_S16};
+					}
+					break;
+				case(LOS_BONE_INDICES):
+					switch(member->type)
+					{
+						case(LOT_BYTE4B):
+						case(LOT_BYTE4E): return {OP_INDICES_U8};
+						case(LOT_SHORT_BONE_INDICES): return {OP_INDICES_U16};
+					}
+					break;
+				case(LOS_NORMAL):
+					switch(member->type)
+					{
+						case(LOT_FLOAT3): return {OP_NORMAL_F3};
+						case(LOT_FLOAT4): return {OP_NORMAL_F4};
+						case(LOT_BYTE4A):
+						case(LOT_BYTE4B):
+						case(LOT_BYTE4C):
+						case(LOT_BYTE4E): return {OP_NORMAL_U8};
+						case(LOT_SHORT4_TO_FLOAT4A): return {OP_NORMAL_S16};
+						case(LOT_SHORT4_TO_FLOAT4B): return {OP_NORMAL_U16};
+					}
+					break;
+				case(LOS_UV):
+					switch(member->type)
+					{
+						case(LOT_FLOAT2): return {OP_UV_F2};
+						case(LOT_FLOAT3): return {OP_UV_F3};
+						case(LOT_FLOAT4): return {OP_UV_F4};
+						case(LOT_BYTE4A):
+						case(LOT_BYTE4B):
+						case(LOT_BYTE4C):
+						case(LOT_UV): return {OP_UV_S16};
+						case(LOT_UV_PAIR): return {OP_UV_S16_PAIR};
+						case(LOT_SHORT4_TO_FLOAT4B): return {OP_UV_S16X3};
+					}
+					break;
+				case(LOS_TANGENT):
+					switch(member->type)
+					{
+						case(LOT_FLOAT4): return {OP_TANGENT_F4};
+						case(LOT_BYTE4A):
+						case(LOT_BYTE4B):
+						case(LOT_BYTE4C):
+						case(LOT_BYTE4E): return {OP_TANGENT_U8};
+						case(LOT_SHORT4_TO_FLOAT4A): return {OP_TANGENT_S16};
+					}
+					break;
+				case(LOS_BITANGENT):
+					switch(member->type)
+					{
+						case(LOT_BYTE4A):
+						case(LOT_BYTE4B):
+						case(LOT_BYTE4C):
+						case(LOT_BYTE4E): return {OP_BITANGENT_U8};
+					}
+					break;
+				case(LOS_VERTEX_COLOR):
+					switch(member->type)
+					{
+						case(LOT_FLOAT4): return {OP_COLOR_F4};
+						case(LOT_BYTE4A):
+						case(LOT_BYTE4C): return {OP_COLOR_U8};
+					}
+					break;
+				default:
+					unknown(member,"semantic");
+			}
+			unknown(member,"type");
+		};
+
+		template <typename T, bool BE>
+		static T load(const u8* p)
+		{
+			if constexpr(sizeof(T) == 1)
+			{
+				return (T)*p;
+			}
+			else
+			{
+				using U = std::conditional_t<sizeof(T) == 2,u16,u32>;
+				U u;
+				memcpy(&u,p,sizeof(U));
+				if constexpr(BE && sizeof(T) == 2)
+					u = __builtin_bswap16(u);
+				else if constexpr(BE && sizeof(T) == 4)
+					u = __builtin_bswap32(u);
+				T t;
+				memcpy(&t,&u,sizeof(T));
+				return t;
+			}
+		};
+
+		template <bool BE>
+		static vec3f f32x3(const u8* p)
+		{
+			return vec3f(load<float,BE>(p),load<float,BE>(p+4),load<float,BE>(p+8));
+		};
+
+		//fills one attribute array from every vertex, count vertices stride bytes apart
+		template <typename T, typename F>
+		static void column(const u8* src, i64 count, i64 stride, T* dst, F convert)
+		{
+			for(i64 i = 0; i < count; i++, src += stride)
+				dst[i] = convert(src);
+		};
+
+		template <bool BE>
+		void decode_op(const op_t& op, const u8* src, i64 count, i64 stride, vertex_arrays_t& dst,
+			i32& uv, i32& tangent, i32& color, float uv_factor) const
+		{
+			const u8* p = src + op.offset;
+			switch(op.code)
+			{
+				case(OP_POSITION_F3):
+				case(OP_POSITION_F4):
+					dst.add(vertex_arrays_t::VA_POSITION);
+					column(p,count,stride,dst.positions.data(),[](const u8* p){return f32x3<BE>(p);});
+					break;
+				case(OP_POSITION_EDGE):
+					dst.add(vertex_arrays_t::VA_POSITION);
+					std::fill(dst.positions.begin(),dst.positions.end(),vec3f(0.0f,0.0f,0.0f));
+					break;
+				case(OP_WEIGHTS_S8):
+					dst.add(vertex_arrays_t::VA_BONE_WEIGHTS);
+					decode_norm4<NORM_I8,BE>(p,count,stride,(float*)dst.bone_weights.data(),4,4);
+					break;
+				case(OP_WEIGHTS_U8):
+					dst.add(vertex_arrays_t::VA_BONE_WEIGHTS);
+					decode_norm4<NORM_U8,BE>(p,count,stride,(float*)dst.bone_weights.data(),4,4);
+					break;
+				case(OP_WEIGHTS_S16):
+					dst.add(vertex_arrays_t::VA_BONE_WEIGHTS);
+					decode_norm4<NORM_I16,BE>(p,count,stride,(float*)dst.bone_weights.data(),4,4);
+					break;
+				case(OP_INDICES_U8):
+					dst.add(vertex_arrays_t::VA_BONE_INDICES);
+					column(p,count,stride,dst.bone_indices.data(),[](const u8* p)
+					{
+						return vertex_bone_indices_t(p[0],p[1],p[2],p[3]);
+					});
+					break;
+				case(OP_INDICES_U16):
+					dst.add(vertex_arrays_t::VA_BONE_INDICES);
+					column(p,count,stride,dst.bone_indices.data(),[](const u8* p)
+					{
+						return vertex_bone_indices_t(
+							load<u16,BE>(p),load<u16,BE>(p+2),load<u16,BE>(p+4),load<u16,BE>(p+6)
+						);
+					});
+					break;
+				case(OP_NORMAL_F3):
+					dst.add(vertex_arrays_t::VA_NORMAL);
+					column(p,count,stride,dst.normals.data(),[](const u8* p){return f32x3<BE>(p);});
+					break;
+				case(OP_NORMAL_F4):
+					dst.add(vertex_arrays_t::VA_NORMAL);
+					column(p,count,stride,dst.normals.data(),[](const u8* p){return f32x3<BE>(p);});
+					column(p,count,stride,dst.normal_ws.data(),[](const u8* p)
+					{
+						float w = load<float,BE>(p+12);
+						i32 normal_w = (i32)w;
+						if(w != normal_w)
+							throw std::runtime_error("Bad W!\n");
+						return normal_w;
+					});
+					break;
+				case(OP_NORMAL_U8):
+					dst.add(vertex_arrays_t::VA_NORMAL);
+					decode_norm4<NORM_U8_BIASED,BE>(p,count,stride,(float*)dst.normals.data(),3,3);
+					column(p,count,stride,dst.normal_ws.data(),[](const u8* p){return (i32)p[3];});
+					break;
+				case(OP_NORMAL_S16):
+					dst.add(vertex_arrays_t::VA_NORMAL);
+					decode_norm4<NORM_I16,BE>(p,count,stride,(float*)dst.normals.data(),3,3);
+					column(p,count,stride,dst.normal_ws.data(),[](const u8* p){return (i32)load<i16,BE>(p+6);});
+					break;
+				case(OP_NORMAL_U16):
+					dst.add(vertex_arrays_t::VA_NORMAL);
+					decode_norm4<NORM_U16_BIASED,BE>(p,count,stride,(float*)dst.normals.data(),3,3);
+					column(p,count,stride,dst.normal_ws.data(),[](const u8* p){return (i32)load<i16,BE>(p+6);});
+					break;
+				case(OP_UV_F2):
+					column(p,count,stride,dst.uvs[uv++].data(),[](const u8* p)
+					{
+						return vec3f(load<float,BE>(p),load<float,BE>(p+4),0.0f);
+					});
+					break;
+				case(OP_UV_F3):
+					column(p,count,stride,dst.uvs[uv++].data(),[](const u8* p){return f32x3<BE>(p);});
+					break;
+				case(OP_UV_F4):
+					column(p,count,stride,dst.uvs[uv++].data(),[](const u8* p)
+					{
+						return vec3f(load<float,BE>(p),load<float,BE>(p+4),0.0f);
+					});
+					column(p+8,count,stride,dst.uvs[uv++].data(),[](const u8* p)
+					{
+						return vec3f(load<float,BE>(p),load<float,BE>(p+4),0.0f);
+					});
+					break;
+				case(OP_UV_S16):
+					decode_uv_i16<BE>(p,count,stride,(float*)dst.uvs[uv++].data(),3,uv_factor);
+					break;
+				case(OP_UV_S16_PAIR):
+					decode_uv_i16<BE>(p,count,stride,(float*)dst.uvs[uv++].data(),3,uv_factor);
+					decode_uv_i16<BE>(p+4,count,stride,(float*)dst.uvs[uv++].data(),3,uv_factor);
+					break;
+				case(OP_UV_S16X3):
+					column(p,count,stride,dst.uvs[uv++].data(),[&](const u8* p)
+					{
+						return vec3f(load<i16,BE>(p),load<i16,BE>(p+2),load<i16,BE>(p+4))/uv_factor;
+					});
+					break;
+				case(OP_TANGENT_F4):
+					column(p,count,stride,dst.tangents[tangent++].data(),[](const u8* p)
+					{
+						return vec4f(load<float,BE>(p),load<float,BE>(p+4),load<float,BE>(p+8),load<float,BE>(p+12));
+					});
+					break;
+				case(OP_TANGENT_U8):
+					decode_norm4<NORM_U8_BIASED,BE>(p,count,stride,(float*)dst.tangents[tangent++].data(),4,4);
+					break;
+				case(OP_TANGENT_S16):
+					decode_norm4<NORM_I16,BE>(p,count,stride,(float*)dst.tangents[tangent++].data(),4,4);
+					break;
+				case(OP_BITANGENT_U8):
+					dst.add(vertex_arrays_t::VA_BITANGENT);
+					decode_norm4<NORM_U8_BIASED,BE>(p,count,stride,(float*)dst.bitangents.data(),4,4);
+					break;
+				case(OP_COLOR_F4):
+					column(p,count,stride,dst.colors[color++].data(),[](const u8* p)
+					{
+						vertex_color_t c;
+						c.r = load<float,BE>(p);
+						c.g = load<float,BE>(p+4);
+						c.b = load<float,BE>(p+8);
+						c.a = load<float,BE>(p+12);
+						return c;
+					});
+					break;
+				case(OP_COLOR_U8):
+					column(p,count,stride,dst.colors[color++].data(),[](const u8* p)
+					{
+						vertex_color_t c;
+						c.r = (float)p[0] / 255.0f;
+						c.g = (float)p[1] / 255.0f;
+						c.b = (float)p[2] / 255.0f;
+						c.a = (float)p[3] / 255.0f;
+						return c;
+					});
+					break;
+			}
+		};
+
+		public:
+		vertex_plan_t() = default;
+
+		//throws on members vertex_t can't read, as vertex_t::read does
+		static vertex_plan_t compile(const std::vector<layout_member_t*>& layout)
+		{
+			vertex_plan_t plan;
+			plan.m_ops.reserve(layout.size());
+			for(const layout_member_t* member : layout)
+			{
+				op_t op = compile(member);
+				op.offset = plan.m_size;
+				plan.m_size += layout_type_size(member->type);
+				plan.m_ops.push_back(op);
+
+				switch(op.code)
+				{
+					case(OP_UV_F4):
+					case(OP_UV_S16_PAIR): plan.m_uvs += 2; break;
+					case(OP_UV_F2):
+					case(OP_UV_F3):
+					case(OP_UV_S16):
+					case(OP_UV_S16X3): plan.m_uvs++; break;
+					case(OP_TANGENT_F4):
+					case(OP_TANGENT_U8):
+					case(OP_TANGENT_S16): plan.m_tangents++; break;
+					case(OP_COLOR_F4):
+					case(OP_COLOR_U8): plan.m_colors++; break;
+					case(OP_POSITION_EDGE): plan.m_edge = true; break;
+					default: break;
+				}
+			}
+			return plan;
+		};
+
+		//bytes of a vertex the layout describes
+		i32 size() const {return m_size;};
+
+		/*
+			decodes count vertices stride bytes apart from src into dst, which
+			must already hold count vertices. stride is the buffer's vertex
+			size, which may pad past size(). each op fills its whole array
+			before the next one runs
+		*/
+		template <bool BE>
+		void decode(const u8* src, i64 count, i64 stride, vertex_arrays_t& dst, float uv_factor) const
+		{
+			if(count != dst.count)
+				throw std::runtime_error("flver::vertex_plan_t buffer and mesh vertex counts differ!\n");
+			if(m_edge && count > 0)
+				printf("Error: Edge compressed vertex!\n");
+
+			i32 uv = dst.add_uvs(m_uvs);
+			i32 tangent = dst.add_tangents(m_tangents);
+			i32 color = dst.add_colors(m_colors);
+			for(const op_t& op : m_ops)
+				decode_op<BE>(op,src,count,stride,dst,uv,tangent,color,uv_factor);
+		};
+
+		void decode(const u8* src, i64 count, i64 stride, vertex_arrays_t& dst, float uv_factor, bool big_endian) const
+		{
+			if(big_endian)
+				decode<true>(src,count,stride,dst,uv_factor);
+			else
+				decode<false>(src,count,stride,dst,uv_factor);
+		};
+
+		/*
+			decodes dst.count vertices starting at position in mem without
+			touching its cursor, so several buffers of one UMEM can be decoded
+			at once. memory is decoded in place, files through one read
+		*/
+		void decode_at(UMEM* mem, i64 position, i64 stride, vertex_arrays_t& dst, float uv_factor, bool big_endian) const
+		{
+			i64 count = dst.count;
+			if(count <= 0)
+				return;
+			if(stride < m_size)
+				throw std::runtime_error("flver::vertex_plan_t vertex size smaller than its layout!\n");
+
+			i64 bytes = (count - 1) * stride + m_size;
+			const u8* src = mem->view(position,bytes);
+			if(src != nullptr)
+			{
+				decode(src,count,stride,dst,uv_factor,big_endian);
+			}
+			else
+			{
+				std::vector<u8> raw(bytes);
+				if(mem->read_at(raw.data(),bytes,position) != bytes)
+					throw std::runtime_error("flver::vertex_plan_t vertex buffer past the end!\n");
+				decode(raw.data(),count,stride,dst,uv_factor,big_endian);
+			}
+		};
+
+		//decodes dst.count vertices from mem's cursor, which moves to the end of the buffer
+		void decode(UMEM* mem, i64 stride, vertex_arrays_t& dst, float uv_factor) const
+		{
+			if(dst.count <= 0)
+				return;
+			decode_at(mem,mem->m_pos,stride,dst,uv_factor,mem->big_endian());
+			mem->seek(dst.count * stride,SEEK_CUR);
+		};
+	};
+
+	inline void vertex_t::read(UMEM* mem, const std::vector<layout_member_t*>& layout, float uv_factor)
+	{
+		vertex_plan_t plan = vertex_plan_t::compile(layout);
+		vertex_arrays_t arrays(1);
+		plan.decode(mem,plan.size(),arrays,uv_factor);
+		arrays.copy_to(0,*this);
+	};
+};
\ No newline at end of file
@@ -0,0 +1,403 @@
+#include "index.h"
+#include "../binder/binder.h"
+#include "../formats/dcx.h"
+#include "../util/thread_pool.h"
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	//an entry before its path is placed in the string table
+	struct scanned_t
+	{
+		std::string path;
+		index_entry_t entry;
+	};
+
+	struct scanned_container_t
+	{
+		std::string path; //relative to the root
+		i64 mtime = 0;
+		i64 size = 0;
+		std::vector<scanned_t> entries = {};
+	};
+
+	bool has_magic(UMEM* mem, const char* magic)
+	{
+		char m[4];
+		return mem->read_at(m,4,0) == 4 && memcmp(m,magic,4) == 0;
+	};
+
+	bool is_binder(UMEM* mem)
+	{
+		return has_magic(mem,"BND3") || has_magic(mem,"BND4") || has_magic(mem,"BHF3") || has_magic(mem,"BHF4");
+	};
+
+	i64 file_mtime(const fs::path& path, std::error_code& err)
+	{
+		return fs::last_write_time(path,err).time_since_epoch().count();
+	};
+
+	//records every entry of the binder in mem, descending into nested containers
+	void scan_binder(UMEM* mem, const std::string& vpath, u32 container, u32 depth, std::vector<scanned_t>& out)
+	{
+		mem->seek(0,SEEK_SET);
+		std::unique_ptr<binder_t> bnd(binder_t::read(mem));
+		if(bnd == nullptr)
+			return;
+
+		UMEM* src = bnd->source();
+		for(const file_header_t& fh : bnd->get_headers())
+		{
+			i64 stored = fh.compressed_size();
+			sp<UMEM> data(uopen(std::max<i64>(stored,0)),uclose);
+			if(stored > 0 && src->read_at(data->m_data,stored,fh.offset()) != stored)
+				throw std::runtime_error("archive_index_t: short read in "+vpath+"\n");
+
+			scanned_t s;
+			s.path = vpath + "//" + fh.name();
+			index_entry_t& e = s.entry;
+			memset(&e,0,sizeof(e));
+			e.path_hash = xxh64(s.path.data(),s.path.size());
+			e.container = container;
+			e.depth = depth;
+			e.file_flags = fh.flags();
+			e.offset = fh.offset();
+			e.stored_size = stored;
+			e.size = fh.size();
+			e.content_hash = xxh64(data->m_data,stored);
+
+			//compressed entries record their format and inflated size
+			if(has_magic(data.get(),"DCX\0") && stored >= 0x2C)
+			{
+				memcpy(&e.compression,data->m_data+0x28,4);
+				e.size = load_field<u32,true>(data->m_data+0x1C);
+			}
+			out.push_back(s);
+
+			sp<UMEM> inner = dcx_t::inflate(data.get());
+			UMEM* payload = inner != nullptr ? inner.get() : data.get();
+			if(is_binder(payload))
+				scan_binder(payload,s.path,container,depth + 1,out);
+		}
+	};
+
+	void scan_container(const fs::path& file, u32 container, scanned_container_t& out)
+	{
+		UMEM* mem = uopen(file.string(),"rb");
+		if(!mem->can_read())
+		{
+			uclose(mem);
+			return;
+		}
+
+		try
+		{
+			sp<UMEM> inner = dcx_t::inflate(mem);
+			UMEM* payload = inner != nullptr ? inner.get() : mem;
+			if(is_binder(payload))
+				scan_binder(payload,out.path,container,0,out.entries);
+		}
+		catch(std::exception& e)
+		{
+			//a broken container is indexed as empty rather than failing the build
+			printf("archive_index_t: skipping %s: %s",out.path.c_str(),e.what());
+			out.entries.clear();
+		}
+		uclose(mem);
+	};
+
+	//whether the file at path starts like something the index can hold
+	bool is_container_file(const fs::path& path)
+	{
+		FILE* f = fopen(path.string().c_str(),"rb");
+		if(f == nullptr)
+			return false;
+		char m[4];
+		bool r = fread(m,1,4,f) == 4 && (
+			memcmp(m,"DCX\0",4) == 0 || memcmp(m,"BND3",4) == 0 || memcmp(m,"BND4",4) == 0
+			|| memcmp(m,"BHF3",4) == 0 || memcmp(m,"BHF4",4) == 0
+		);
+		fclose(f);
+		return r;
+	};
+};
+
+i32 archive_index_t::build(const std::string& root, const std::string& path, const archive_index_t* previous, i32 threads)
+{
+	std::error_code err;
+	std::vector<scanned_container_t> containers;
+	std::vector<fs::path> files;
+	for(fs::recursive_directory_iterator it(root,err), end; !err && it != end; it.increment(err))
+	{
+		if(!it->is_regular_file(err) || !is_container_file(it->path()))
+			continue;
+		scanned_container_t c;
+		c.path = fs::relative(it->path(),root,err).generic_string();
+		c.mtime = file_mtime(it->path(),err);
+		c.size = it->file_size(err);
+		containers.push_back(std::move(c));
+		files.push_back(it->path());
+	}
+	if(err)
+		return -1;
+
+	//stable container ids make rebuilds reproducible
+	std::vector<u32> order(containers.size());
+	for(u32 i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(),order.end(),[&](u32 a, u32 b){return containers[a].path < containers[b].path;});
+	{
+		std::vector<scanned_container_t> sorted_containers(containers.size());
+		std::vector<fs::path> sorted_files(files.size());
+		for(u32 i = 0; i < order.size(); i++)
+		{
+			sorted_containers[i] = std::move(containers[order[i]]);
+			sorted_files[i] = std::move(files[order[i]]);
+		}
+		containers = std::move(sorted_containers);
+		files = std::move(sorted_files);
+	}
+
+	//entries of containers that haven't changed are taken from the previous index
+	std::vector<bool> reused(containers.size(),false);
+	if(previous != nullptr && previous->is_open())
+	{
+		umap<std::string,u32> prev_ids;
+		for(u32 i = 0; i < previous->container_count(); i++)
+			prev_ids[std::string(previous->path(previous->container(i)))] = i;
+
+		std::vector<i64> prev_to_new(previous->container_count(),-1);
+		for(u32 i = 0; i < containers.size(); i++)
+		{
+			auto it = prev_ids.find(containers[i].path);
+			if(it == prev_ids.end())
+				continue;
+			const index_container_t& pc = previous->container(it->second);
+			if(pc.mtime == containers[i].mtime && pc.size == containers[i].size)
+			{
+				prev_to_new[it->second] = i;
+				reused[i] = true;
+			}
+		}
+
+		for(u32 i = 0; i < previous->entry_count(); i++)
+		{
+			const index_entry_t& e = previous->entry(i);
+			if(e.container >= previous->container_count())
+				continue;
+			i64 to = prev_to_new[e.container];
+			if(to < 0)
+				continue;
+			scanned_t s;
+			s.path = std::string(previous->path(e));
+			s.entry = e;
+			s.entry.container = to;
+			containers[to].entries.push_back(std::move(s));
+		}
+	}
+
+	thread_pool_t pool(threads);
+	pool.parallel_for(containers.size(),[&](i64 i)
+	{
+		if(!reused[i])
+			scan_container(files[i],i,containers[i]);
+	});
+
+	//lay out the string table and the sorted entry table
+	std::string strings;
+	std::vector<index_container_t> table_c(containers.size());
+	std::vector<index_entry_t> table_e;
+	for(u32 i = 0; i < containers.size(); i++)
+	{
+		table_c[i].path_offset = strings.size();
+		table_c[i].path_size = containers[i].path.size();
+		table_c[i].mtime = containers[i].mtime;
+		table_c[i].size = containers[i].size;
+		strings.append(containers[i].path);
+
+		for(scanned_t& s : containers[i].entries)
+		{
+			s.entry.path_offset = strings.size();
+			s.entry.path_size = s.path.size();
+			strings.append(s.path);
+			table_e.push_back(s.entry);
+		}
+	}
+	if(strings.size() > UINT32_MAX)
+		return -1;
+
+	std::sort(table_e.begin(),table_e.end(),[&](const index_entry_t& a, const index_entry_t& b)
+	{
+		if(a.path_hash != b.path_hash)
+			return a.path_hash < b.path_hash;
+		return strings.compare(a.path_offset,a.path_size,strings,b.path_offset,b.path_size) < 0;
+	});
+
+	index_header_t h;
+	memset(&h,0,sizeof(h));
+	memcpy(h.magic,"BIDX",4);
+	h.version = VERSION;
+	h.container_count = table_c.size();
+	h.entry_count = table_e.size();
+	h.containers_offset = sizeof(h);
+	h.entries_offset = h.containers_offset + table_c.size() * sizeof(index_container_t);
+	h.strings_offset = h.entries_offset + table_e.size() * sizeof(index_entry_t);
+	h.strings_size = strings.size();
+
+	//written next to path first, so a reader never maps half an index
+	std::string tmp = path + ".tmp";
+	FILE* f = fopen(tmp.c_str(),"wb");
+	if(f == nullptr)
+		return -1;
+	bool ok = fwrite(&h,sizeof(h),1,f) == 1;
+	ok &= fwrite(table_c.data(),sizeof(index_container_t),table_c.size(),f) == table_c.size();
+	ok &= fwrite(table_e.data(),sizeof(index_entry_t),table_e.size(),f) == table_e.size();
+	ok &= fwrite(strings.data(),1,strings.size(),f) == strings.size();
+	ok &= fclose(f) == 0;
+	if(!ok)
+	{
+		std::remove(tmp.c_str());
+		return -1;
+	}
+
+#ifdef WIN32
+	std::remove(path.c_str());
+#endif
+	if(std::rename(tmp.c_str(),path.c_str()) != 0)
+	{
+		std::remove(tmp.c_str());
+		return -1;
+	}
+	return 0;
+};
+
+void archive_index_t::unmap()
+{
+#ifndef WIN32
+	if(m_data != nullptr && m_buffer.empty())
+		munmap((void*)m_data,m_size);
+#endif
+	m_buffer.clear();
+	m_data = nullptr;
+	m_size = 0;
+	m_state.reset();
+};
+
+i32 archive_index_t::open(const std::string& path, const std::string& root)
+{
+	unmap();
+
+#ifdef WIN32
+	FILE* f = fopen(path.c_str(),"rb");
+	if(f == nullptr)
+		return -1;
+	fseek(f,0,SEEK_END);
+	m_buffer.resize(ftell(f));
+	fseek(f,0,SEEK_SET);
+	bool ok = fread(m_buffer.data(),1,m_buffer.size(),f) == m_buffer.size();
+	fclose(f);
+	if(!ok)
+		return -1;
+	m_data = m_buffer.data();
+	m_size = m_buffer.size();
+#else
+	int fd = ::open(path.c_str(),O_RDONLY);
+	if(fd < 0)
+		return -1;
+	i64 size = lseek(fd,0,SEEK_END);
+	void* map = size > 0 ? mmap(nullptr,size,PROT_READ,MAP_PRIVATE,fd,0) : MAP_FAILED;
+	close(fd);
+	if(map == MAP_FAILED)
+		return -1;
+	m_data = (const u8*)map;
+	m_size = size;
+#endif
+
+	const index_header_t* h = header();
+	bool valid = m_size >= sizeof(index_header_t)
+		&& memcmp(h->magic,"BIDX",4) == 0
+		&& h->version == VERSION
+		&& h->containers_offset + (u64)h->container_count * sizeof(index_container_t) <= m_size
+		&& h->entries_offset + (u64)h->entry_count * sizeof(index_entry_t) <= m_size
+		&& h->strings_offset + h->strings_size <= m_size;
+	if(!valid)
+	{
+		unmap();
+		return -1;
+	}
+
+	//entries and containers are checked as they are used, so opening doesn't touch every page
+	m_root = root;
+	m_state.reset(new std::atomic<u8>[h->container_count]());
+	return 0;
+};
+
+bool archive_index_t::stale(u32 i) const
+{
+	if(!is_open() || i >= header()->container_count)
+		return true;
+
+	//one stat per container, on the first lookup that lands in it
+	u8 state = m_state[i].load(std::memory_order_relaxed);
+	if(state == 0)
+	{
+		const index_container_t& c = container(i);
+		bool changed = c.path_offset + (u64)c.path_size > header()->strings_size;
+		if(!changed)
+		{
+			std::error_code err;
+			fs::path file = fs::path(m_root) / std::string(path(c));
+			i64 size = fs::file_size(file,err);
+			i64 mtime = err ? 0 : file_mtime(file,err);
+			changed = err || size != c.size || mtime != c.mtime;
+		}
+		state = changed ? 2 : 1;
+		m_state[i].store(state,std::memory_order_relaxed);
+	}
+	return state == 2;
+};
+
+const index_entry_t* archive_index_t::find(std::string_view vpath) const
+{
+	if(!is_open())
+		return nullptr;
+
+	u64 hash = xxh64(vpath.data(),vpath.size());
+	const index_entry_t* begin = &entry(0);
+	const index_entry_t* end = begin + header()->entry_count;
+	const index_entry_t* it = std::lower_bound(begin,end,hash,[](const index_entry_t& e, u64 h){return e.path_hash < h;});
+
+	for(; it != end && it->path_hash == hash; it++)
+	{
+		if(path(*it) != vpath)
+			continue;
+		if(stale(it->container))
+			return nullptr;
+		return it;
+	}
+	return nullptr;
+};
+
+//a range past the string table reads as no path
+std::string_view archive_index_t::path(const index_entry_t& entry) const
+{
+	if(!is_open() || entry.path_offset + (u64)entry.path_size > header()->strings_size)
+		return "";
+	return std::string_view((const char*)m_data + header()->strings_offset + entry.path_offset,entry.path_size);
+};
+
+std::string_view archive_index_t::path(const index_container_t& container) const
+{
+	if(!is_open() || container.path_offset + (u64)container.path_size > header()->strings_size)
+		return "";
+	return std::string_view((const char*)m_data + header()->strings_offset + container.path_offset,container.path_size);
+};
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+#include "../common.h"
+#include "../util/hash.h"
+#include <atomic>
+#include <string_view>
+
+/*
+	persistent index of what every container under a directory holds, so
+	lookups don't have to parse binder headers again. the file is a header
+	followed by flat tables and is used in place through mmap. entries are
+	sorted by the hash of their virtual path, which is the path of the os
+	file relative to the scanned root followed by "//" and entry names as
+	vfs_t takes them. containers whose mtime or size changed since the
+	index was built are stale and their entries are not returned
+*/
+
+//all offsets are from the start of the index file, host byte order
+struct index_header_t
+{
+	char magic[4]; //"BIDX"
+	u32 version;
+	u32 container_count;
+	u32 entry_count;
+	u64 containers_offset;
+	u64 entries_offset;
+	u64 strings_offset;
+	u64 strings_size;
+};
+
+//an os file that holds entries
+struct index_container_t
+{
+	u32 path_offset; //relative to the scanned root, into the string table
+	u32 path_size;
+	i64 mtime;
+	i64 size;
+};
+
+struct index_entry_t
+{
+	u64 path_hash;    //xxh64 of the virtual path
+	u32 path_offset;  //virtual path, into the string table
+	u32 path_size;
+	u32 container;    //os file the chain of containers starts at
+	u32 depth;        //binders between the os file and the entry
+	i32 file_flags;   //as stored in the binder's header
+	u32 compression;  //fourcc of the dcx format the entry is stored as, 0 if raw
+	i64 offset;       //data offset in the innermost container, inflated
+	i64 stored_size;
+	i64 size;         //uncompressed
+	u64 content_hash; //xxh64 of the stored bytes
+};
+
+static_assert(sizeof(index_header_t) == 48);
+static_assert(sizeof(index_container_t) == 24);
+static_assert(sizeof(index_entry_t) == 64);
+
+class archive_index_t
+{
+	static constexpr u32 VERSION = 1;
+
+	const u8* m_data = nullptr;
+	i64 m_size = 0;
+	std::vector<u8> m_buffer = {}; //backs m_data where mmap isn't available
+	std::string m_root = "";
+	//per container, 0 until its first lookup stats it, then 1 if unchanged and 2 if not
+	mutable std::unique_ptr<std::atomic<u8>[]> m_state = nullptr;
+
+	const index_header_t* header() const {return (const index_header_t*)m_data;};
+
+	void unmap();
+
+	public:
+	archive_index_t() = default;
+	archive_index_t(const archive_index_t&) = delete;
+	archive_index_t& operator=(const archive_index_t&) = delete;
+	~archive_index_t() {unmap();};
+
+	/*
+		scans every container under root and writes the index to path.
+		containers unchanged since previous, if given, are copied from it
+		rather than scanned again. returns 0 on success
+	*/
+	static i32 build(
+		const std::string& root, const std::string& path,
+		const archive_index_t* previous = nullptr, i32 threads = 0
+	);
+
+	//maps the index at path, 0 on success. containers under root are checked as lookups reach them
+	i32 open(const std::string& path, const std::string& root);
+
+	bool is_open() const {return m_data != nullptr;};
+
+	//nullptr if vpath isn't indexed or its container changed
+	const index_entry_t* find(std::string_view vpath) const;
+
+	std::string_view path(const index_entry_t& entry) const;
+
+	std::string_view path(const index_container_t& container) const;
+
+	u32 entry_count() const {return is_open() ? header()->entry_count : 0;};
+
+	u32 container_count() const {return is_open() ? header()->container_count : 0;};
+
+	const index_entry_t& entry(u32 i) const
+	{
+		return ((const index_entry_t*)(m_data + header()->entries_offset))[i];
+	};
+
+	const index_container_t& container(u32 i) const
+	{
+		return ((const index_container_t*)(m_data + header()->containers_offset))[i];
+	};
+
+	//whether container i changed on disk since the index was built, or isn't one
+	bool stale(u32 i) const;
+
+	const std::string& root() const {return m_root;};
+};
\ No newline at end of file
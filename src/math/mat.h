@@ -0,0 +1,333 @@
+#pragma once
+#include "vec.h"
+#ifdef __SSE__
+#include <immintrin.h>
+#endif
+
+/*
+	4x4 float matrix for row vectors, p' = p * m, so a * b applies a first
+	and translation sits in the last row. the same convention as the
+	System.Numerics matrices the format tools are written against. rows
+	are 16 byte aligned so each one is a single sse register
+*/
+struct alignas(16) mat4f
+{
+	float m[4][4];
+
+#ifdef __SSE__
+	__m128 row(i32 i) const {return _mm_load_ps(m[i]);};
+#endif
+
+	static mat4f identity()
+	{
+		mat4f r = {};
+		for(i32 i = 0; i < 4; i++)
+			r.m[i][i] = 1.0f;
+		return r;
+	};
+
+	static mat4f scale(vec3f s)
+	{
+		mat4f r = identity();
+		r.m[0][0] = s.x;
+		r.m[1][1] = s.y;
+		r.m[2][2] = s.z;
+		return r;
+	};
+
+	static mat4f translate(vec3f t)
+	{
+		mat4f r = identity();
+		r.m[3][0] = t.x;
+		r.m[3][1] = t.y;
+		r.m[3][2] = t.z;
+		return r;
+	};
+
+	static mat4f rotate_x(float a)
+	{
+		mat4f r = identity();
+		float c = cosf(a), s = sinf(a);
+		r.m[1][1] = c;
+		r.m[1][2] = s;
+		r.m[2][1] = -s;
+		r.m[2][2] = c;
+		return r;
+	};
+
+	static mat4f rotate_y(float a)
+	{
+		mat4f r = identity();
+		float c = cosf(a), s = sinf(a);
+		r.m[0][0] = c;
+		r.m[0][2] = -s;
+		r.m[2][0] = s;
+		r.m[2][2] = c;
+		return r;
+	};
+
+	static mat4f rotate_z(float a)
+	{
+		mat4f r = identity();
+		float c = cosf(a), s = sinf(a);
+		r.m[0][0] = c;
+		r.m[0][1] = s;
+		r.m[1][0] = -s;
+		r.m[1][1] = c;
+		return r;
+	};
+
+	/*
+		scale(s) * rotate_x(r.x) * rotate_z(r.z) * rotate_y(r.y) * translate(t)
+		in closed form, the transform of a bone relative to its parent
+	*/
+	static mat4f euler_xzy(vec3f s, vec3f r, vec3f t)
+	{
+		float cx = cosf(r.x), sx = sinf(r.x);
+		float cy = cosf(r.y), sy = sinf(r.y);
+		float cz = cosf(r.z), sz = sinf(r.z);
+
+		mat4f o = {};
+		o.m[0][0] = s.x * (cz*cy);
+		o.m[0][1] = s.x * sz;
+		o.m[0][2] = s.x * (-cz*sy);
+		o.m[1][0] = s.y * (-cx*sz*cy + sx*sy);
+		o.m[1][1] = s.y * (cx*cz);
+		o.m[1][2] = s.y * (cx*sz*sy + sx*cy);
+		o.m[2][0] = s.z * (sx*sz*cy + cx*sy);
+		o.m[2][1] = s.z * (-sx*cz);
+		o.m[2][2] = s.z * (-sx*sz*sy + cx*cy);
+		o.m[3][0] = t.x;
+		o.m[3][1] = t.y;
+		o.m[3][2] = t.z;
+		o.m[3][3] = 1.0f;
+		return o;
+	};
+
+	mat4f operator*(const mat4f& b) const
+	{
+		mat4f r;
+#ifdef __SSE__
+		__m128 b0 = b.row(0), b1 = b.row(1), b2 = b.row(2), b3 = b.row(3);
+		for(i32 i = 0; i < 4; i++)
+		{
+			__m128 v = _mm_mul_ps(_mm_set1_ps(m[i][0]),b0);
+			v = _mm_add_ps(v,_mm_mul_ps(_mm_set1_ps(m[i][1]),b1));
+			v = _mm_add_ps(v,_mm_mul_ps(_mm_set1_ps(m[i][2]),b2));
+			v = _mm_add_ps(v,_mm_mul_ps(_mm_set1_ps(m[i][3]),b3));
+			_mm_store_ps(r.m[i],v);
+		}
+#else
+		for(i32 i = 0; i < 4; i++)
+			for(i32 j = 0; j < 4; j++)
+				r.m[i][j] = m[i][0]*b.m[0][j] + m[i][1]*b.m[1][j] + m[i][2]*b.m[2][j] + m[i][3]*b.m[3][j];
+#endif
+		return r;
+	};
+
+	vec3f transform(vec3f p) const
+	{
+		return vec3f(
+			p.x*m[0][0] + p.y*m[1][0] + p.z*m[2][0] + m[3][0],
+			p.x*m[0][1] + p.y*m[1][1] + p.z*m[2][1] + m[3][1],
+			p.x*m[0][2] + p.y*m[1][2] + p.z*m[2][2] + m[3][2]
+		);
+	};
+
+	//direction, leaves out the translation
+	vec3f rotate(vec3f v) const
+	{
+		return vec3f(
+			v.x*m[0][0] + v.y*m[1][0] + v.z*m[2][0],
+			v.x*m[0][1] + v.y*m[1][1] + v.z*m[2][1],
+			v.x*m[0][2] + v.y*m[1][2] + v.z*m[2][2]
+		);
+	};
+
+	vec3f translation() const {return vec3f(m[3][0],m[3][1],m[3][2]);};
+
+	//inverse of an affine matrix, identity if it is singular
+	mat4f inverse_affine() const
+	{
+		float a = m[1][1]*m[2][2] - m[1][2]*m[2][1];
+		float b = m[1][2]*m[2][0] - m[1][0]*m[2][2];
+		float c = m[1][0]*m[2][1] - m[1][1]*m[2][0];
+		float det = m[0][0]*a + m[0][1]*b + m[0][2]*c;
+		if(det == 0.0f)
+			return identity();
+		float d = 1.0f / det;
+
+		mat4f r = identity();
+		r.m[0][0] = a*d;
+		r.m[0][1] = (m[0][2]*m[2][1] - m[0][1]*m[2][2])*d;
+		r.m[0][2] = (m[0][1]*m[1][2] - m[0][2]*m[1][1])*d;
+		r.m[1][0] = b*d;
+		r.m[1][1] = (m[0][0]*m[2][2] - m[0][2]*m[2][0])*d;
+		r.m[1][2] = (m[0][2]*m[1][0] - m[0][0]*m[1][2])*d;
+		r.m[2][0] = c*d;
+		r.m[2][1] = (m[0][1]*m[2][0] - m[0][0]*m[2][1])*d;
+		r.m[2][2] = (m[0][0]*m[1][1] - m[0][1]*m[1][0])*d;
+		for(i32 j = 0; j < 3; j++)
+			r.m[3][j] = -(m[3][0]*r.m[0][j] + m[3][1]*r.m[1][j] + m[3][2]*r.m[2][j]);
+		return r;
+	};
+};
+
+/*
+	unit quaternion rotation, x y z the axis part and w the angle part.
+	composes the same way as the matrices, a * b rotates by a first
+*/
+struct alignas(16) quatf
+{
+	float x, y, z, w;
+
+	static quatf identity() {return {0.0f,0.0f,0.0f,1.0f};};
+
+	static quatf axis_angle(vec3f axis, float angle)
+	{
+		vec3f a = axis.normalized() * sinf(angle * 0.5f);
+		return {a.x,a.y,a.z,cosf(angle * 0.5f)};
+	};
+
+	//rotate_x(r.x) * rotate_z(r.z) * rotate_y(r.y) as a quaternion
+	static quatf euler_xzy(vec3f r)
+	{
+		return axis_angle(vec3f(1.0f,0.0f,0.0f),r.x)
+			* axis_angle(vec3f(0.0f,0.0f,1.0f),r.z)
+			* axis_angle(vec3f(0.0f,1.0f,0.0f),r.y);
+	};
+
+	//q applied after this, matching mat4f's order
+	quatf operator*(const quatf& q) const
+	{
+		return {
+			q.w*x + q.x*w + q.y*z - q.z*y,
+			q.w*y - q.x*z + q.y*w + q.z*x,
+			q.w*z + q.x*y - q.y*x + q.z*w,
+			q.w*w - q.x*x - q.y*y - q.z*z
+		};
+	};
+
+	quatf conjugate() const {return {-x,-y,-z,w};};
+
+	quatf normalized() const
+	{
+		float l = sqrtf(x*x + y*y + z*z + w*w);
+		return l > 0.0f ? quatf{x/l,y/l,z/l,w/l} : identity();
+	};
+
+	vec3f rotate(vec3f v) const
+	{
+		vec3f u(x,y,z);
+		vec3f t = u.cross(v) * 2.0f;
+		return v + t * w + u.cross(t);
+	};
+
+	mat4f to_matrix() const
+	{
+		mat4f r = mat4f::identity();
+		r.m[0][0] = 1.0f - 2.0f*(y*y + z*z);
+		r.m[0][1] = 2.0f*(x*y + z*w);
+		r.m[0][2] = 2.0f*(x*z - y*w);
+		r.m[1][0] = 2.0f*(x*y - z*w);
+		r.m[1][1] = 1.0f - 2.0f*(x*x + z*z);
+		r.m[1][2] = 2.0f*(y*z + x*w);
+		r.m[2][0] = 2.0f*(x*z + y*w);
+		r.m[2][1] = 2.0f*(y*z - x*w);
+		r.m[2][2] = 1.0f - 2.0f*(x*x + y*y);
+		return r;
+	};
+};
+
+namespace mat_detail
+{
+#ifdef __AVX2__
+	//24 floats of interleaved xyz to a register of each component
+	inline void deinterleave3(const float* p, __m256& x, __m256& y, __m256& z)
+	{
+		__m256 a = _mm256_loadu_ps(p);
+		__m256 b = _mm256_loadu_ps(p+8);
+		__m256 c = _mm256_loadu_ps(p+16);
+		x = _mm256_blend_ps(_mm256_blend_ps(a,b,0x92),c,0x24);
+		y = _mm256_blend_ps(_mm256_blend_ps(a,b,0x24),c,0x49);
+		z = _mm256_blend_ps(_mm256_blend_ps(a,b,0x49),c,0x92);
+		x = _mm256_permutevar8x32_ps(x,_mm256_setr_epi32(0,3,6,1,4,7,2,5));
+		y = _mm256_permutevar8x32_ps(y,_mm256_setr_epi32(1,4,7,2,5,0,3,6));
+		z = _mm256_permutevar8x32_ps(z,_mm256_setr_epi32(2,5,0,3,6,1,4,7));
+	};
+
+	inline void interleave3(float* p, __m256 x, __m256 y, __m256 z)
+	{
+		x = _mm256_permutevar8x32_ps(x,_mm256_setr_epi32(0,3,6,1,4,7,2,5));
+		y = _mm256_permutevar8x32_ps(y,_mm256_setr_epi32(5,0,3,6,1,4,7,2));
+		z = _mm256_permutevar8x32_ps(z,_mm256_setr_epi32(2,5,0,3,6,1,4,7));
+		_mm256_storeu_ps(p,_mm256_blend_ps(_mm256_blend_ps(x,y,0x92),z,0x24));
+		_mm256_storeu_ps(p+8,_mm256_blend_ps(_mm256_blend_ps(x,y,0x24),z,0x49));
+		_mm256_storeu_ps(p+16,_mm256_blend_ps(_mm256_blend_ps(x,y,0x49),z,0x92));
+	};
+
+	//column j of the upper 3x3 dotted with x, y, z, plus row 3 when points
+	template <bool POINTS>
+	inline __m256 column(const mat4f& m, i32 j, __m256 x, __m256 y, __m256 z)
+	{
+		__m256 v = _mm256_mul_ps(x,_mm256_set1_ps(m.m[0][j]));
+		v = _mm256_add_ps(v,_mm256_mul_ps(y,_mm256_set1_ps(m.m[1][j])));
+		v = _mm256_add_ps(v,_mm256_mul_ps(z,_mm256_set1_ps(m.m[2][j])));
+		if constexpr(POINTS)
+			v = _mm256_add_ps(v,_mm256_set1_ps(m.m[3][j]));
+		return v;
+	};
+#endif
+
+	template <bool POINTS>
+	inline void transform(const mat4f& m, const vec3f* src, vec3f* dst, i64 count)
+	{
+		i64 i = 0;
+#ifdef __AVX2__
+		for(; i + 8 <= count; i += 8)
+		{
+			__m256 x, y, z;
+			deinterleave3((const float*)(src + i),x,y,z);
+			__m256 tx = column<POINTS>(m,0,x,y,z);
+			__m256 ty = column<POINTS>(m,1,x,y,z);
+			__m256 tz = column<POINTS>(m,2,x,y,z);
+			interleave3((float*)(dst + i),tx,ty,tz);
+		}
+#endif
+		for(; i < count; i++)
+			dst[i] = POINTS ? m.transform(src[i]) : m.rotate(src[i]);
+	};
+};
+
+/*
+	bulk kernels, count elements at a time. with AVX2 eight vec3f are
+	deinterleaved into x, y and z registers, transformed and interleaved
+	back, so the loop works on whole registers. src and dst may be the
+	same array
+*/
+
+//dst[i] = src[i] * m as points
+inline void transform_points(const mat4f& m, const vec3f* src, vec3f* dst, i64 count)
+{
+	mat_detail::transform<true>(m,src,dst,count);
+};
+
+//dst[i] = src[i] * m as directions, no translation. normals want the inverse transpose
+inline void transform_vectors(const mat4f& m, const vec3f* src, vec3f* dst, i64 count)
+{
+	mat_detail::transform<false>(m,src,dst,count);
+};
+
+//dst[i] = a[i] * b[i]
+inline void multiply(const mat4f* a, const mat4f* b, mat4f* dst, i64 count)
+{
+	for(i64 i = 0; i < count; i++)
+		dst[i] = a[i] * b[i];
+};
+
+//dst[i] = a[i] * b, every matrix taken into the same space
+inline void multiply(const mat4f* a, const mat4f& b, mat4f* dst, i64 count)
+{
+	for(i64 i = 0; i < count; i++)
+		dst[i] = a[i] * b;
+};
\ No newline at end of file
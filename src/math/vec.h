@@ -1,12 +1,27 @@
 #pragma once
 #include "../common.h"
+#include <math.h>
+
+/*
+	plain packed vectors, the layout files and vertex arrays store them
+	in, so they stay aggregates without padding. math over many of them at
+	once lives in mat.h. components are indexed through member pointers
+	rather than by casting this to a float array
+*/
 
 struct vec2f
 {
 	float x, y;
 
-	float operator[](i32 i) const {return ((float*)this)[i];};
-	float& operator[](i32 i) {return ((float*)this)[i];};
+	static constexpr float vec2f::* members[] = {&vec2f::x,&vec2f::y};
+
+	vec2f operator+(vec2f v) const {return vec2f(x+v.x,y+v.y);};
+	vec2f operator-(vec2f v) const {return vec2f(x-v.x,y-v.y);};
+	vec2f operator*(float f) const {return vec2f(x*f,y*f);};
+	vec2f operator/(float f) const {return vec2f(x/f,y/f);};
+
+	float operator[](i32 i) const {return this->*members[i];};
+	float& operator[](i32 i) {return this->*members[i];};
 };
 
 struct vec3f
@@ -18,38 +33,67 @@ struct vec3f
 	vec3f operator*(float f) const {return vec3f(x*f,y*f,z*f);};
 	vec3f operator/(float f) const {return vec3f(x/f,y/f,z/f);};
 
-	float operator[](i32 i) const {return ((float*)this)[i];};
-	float& operator[](i32 i) {return ((float*)this)[i];};
+	static constexpr float vec3f::* members[] = {&vec3f::x,&vec3f::y,&vec3f::z};
+
+	vec3f operator+(vec3f v) const {return vec3f(x+v.x,y+v.y,z+v.z);};
+	vec3f operator-(vec3f v) const {return vec3f(x-v.x,y-v.y,z-v.z);};
+	vec3f operator*(vec3f v) const {return vec3f(x*v.x,y*v.y,z*v.z);};
+	vec3f operator-() const {return vec3f(-x,-y,-z);};
+
+	float dot(vec3f v) const {return x*v.x + y*v.y + z*v.z;};
+	vec3f cross(vec3f v) const {return vec3f(y*v.z-z*v.y,z*v.x-x*v.z,x*v.y-y*v.x);};
+	float length() const {return sqrtf(dot(*this));};
+	vec3f normalized() const {float l = length(); return l > 0.0f ? *this / l : *this;};
+
+	float operator[](i32 i) const {return this->*members[i];};
+	float& operator[](i32 i) {return this->*members[i];};
 };
 
 struct vec4f
 {
 	float x, y, z, w;
 
-	float operator[](i32 i) const {return ((float*)this)[i];};
-	float& operator[](i32 i) {return ((float*)this)[i];};
+	static constexpr float vec4f::* members[] = {&vec4f::x,&vec4f::y,&vec4f::z,&vec4f::w};
+
+	vec4f operator+(vec4f v) const {return vec4f(x+v.x,y+v.y,z+v.z,w+v.w);};
+	vec4f operator-(vec4f v) const {return vec4f(x-v.x,y-v.y,z-v.z,w-v.w);};
+	vec4f operator*(vec4f v) const {return vec4f(x*v.x,y*v.y,z*v.z,w*v.w);};
+	vec4f operator*(float f) const {return vec4f(x*f,y*f,z*f,w*f);};
+	vec4f operator/(float f) const {return vec4f(x/f,y/f,z/f,w/f);};
+
+	float dot(vec4f v) const {return x*v.x + y*v.y + z*v.z + w*v.w;};
+	vec3f xyz() const {return vec3f(x,y,z);};
+
+	float operator[](i32 i) const {return this->*members[i];};
+	float& operator[](i32 i) {return this->*members[i];};
 };
 
 struct vec2i
 {
 	i32 x, y;
 
-	i32 operator[](i32 i) const {return ((i32*)this)[i];};
-	i32& operator[](i32 i) {return ((i32*)this)[i];};
+	static constexpr i32 vec2i::* members[] = {&vec2i::x,&vec2i::y};
+
+	i32 operator[](i32 i) const {return this->*members[i];};
+	i32& operator[](i32 i) {return this->*members[i];};
 };
 
 struct vec3i
 {
 	i32 x, y, z;
 
-	i32 operator[](i32 i) const {return ((i32*)this)[i];};
-	i32& operator[](i32 i) {return ((i32*)this)[i];};
+	static constexpr i32 vec3i::* members[] = {&vec3i::x,&vec3i::y,&vec3i::z};
+
+	i32 operator[](i32 i) const {return this->*members[i];};
+	i32& operator[](i32 i) {return this->*members[i];};
 };
 
 struct vec4i
 {
 	i32 x, y, z, w;
 
-	i32 operator[](i32 i) const {return ((i32*)this)[i];};
-	i32& operator[](i32 i) {return ((i32*)this)[i];};
+	static constexpr i32 vec4i::* members[] = {&vec4i::x,&vec4i::y,&vec4i::z,&vec4i::w};
+
+	i32 operator[](i32 i) const {return this->*members[i];};
+	i32& operator[](i32 i) {return this->*members[i];};
 };
\ No newline at end of file
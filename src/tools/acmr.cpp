@@ -0,0 +1,139 @@
+#include "../common.h"
+#include "../formats/dcx.h"
+#include "../formats/flver/flver2.h"
+#include <chrono>
+
+/*
+	runs the mesh optimiser over flver files, raw or in a dcx, and prints
+	the average cache miss ratio of every file's face sets before and after
+	along with how long the optimiser took. nothing is written back
+*/
+
+struct totals_t
+{
+	i64 faces = 0;
+	double before = 0.0; //misses, acmr * faces
+	double after = 0.0;
+};
+
+//acmr weighted by faces over every face set of mesh i
+static void measure(flver2_t& flver, i32 i, i32 cache_size, i64& faces, double& misses)
+{
+	for(i32 j = 0; j < flver.mesh(i)->facesets.size(); j++)
+	{
+		flver::triangles_t tris = flver.triangulate(i,j);
+		std::vector<u32> list(tris.size());
+		for(i64 k = 0; k < tris.size(); k++)
+			list[k] = tris[k];
+		faces += tris.faces;
+		misses += flver::acmr(list.data(),list.size(),cache_size) * tris.faces;
+	}
+};
+
+static bool run(const std::string& path, const flver::optimize_options_t& opts, i32 cache_size, totals_t& totals)
+{
+	UMEM* mem = uopen(path,"rb");
+	if(!mem->can_read())
+	{
+		printf("%s: can't open\n",path.c_str());
+		uclose(mem);
+		return false;
+	}
+
+	bool ok = true;
+	dcx_t* dcx = nullptr;
+	UMEM* packed = nullptr; //the dcx file while it is being unwrapped
+	try
+	{
+		char magic[4] = {};
+		mem->read_at(magic,4,0);
+		if(memcmp(magic,"DCX\0",4) == 0)
+		{
+			dcx = dcx_t::open(mem);
+			packed = mem;
+			mem = uopen(dcx->uncompressed_size());
+			dcx->decompress(mem);
+			delete dcx;
+			dcx = nullptr;
+			uclose(packed);
+			packed = nullptr;
+			mem->seek(0,SEEK_SET);
+		}
+
+		flver2_t flver;
+		if(flver.read(mem) != 0)
+			throw std::runtime_error("bad header");
+		flver.load_all();
+
+		i64 faces = 0;
+		double before = 0.0;
+		double after = 0.0;
+		for(i32 i = 0; i < flver.mesh_count(); i++)
+			measure(flver,i,cache_size,faces,before);
+
+		auto start = std::chrono::steady_clock::now();
+		for(i32 i = 0; i < flver.mesh_count(); i++)
+			flver.optimize(i,opts);
+		double ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		faces = 0;
+		for(i32 i = 0; i < flver.mesh_count(); i++)
+			measure(flver,i,cache_size,faces,after);
+
+		printf("%s: %d meshes, %lld faces, acmr %.3f -> %.3f in %.1fms\n",
+			path.c_str(),flver.mesh_count(),(long long)faces,
+			faces ? before / faces : 0.0,faces ? after / faces : 0.0,ms
+		);
+		totals.faces += faces;
+		totals.before += before;
+		totals.after += after;
+	}
+	catch(std::exception& e)
+	{
+		printf("%s: %s\n",path.c_str(),e.what());
+		ok = false;
+	}
+	delete dcx;
+	uclose(packed);
+	uclose(mem);
+	return ok;
+};
+
+int main(int argc, const char** argv)
+{
+	flver::optimize_options_t opts;
+	i32 cache_size = 16;
+	std::vector<std::string> paths;
+
+	for(i32 i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if(arg == "--cache" && i + 1 < argc)
+			cache_size = std::max(1,atoi(argv[++i]));
+		else if(arg == "--no-cache")
+			opts.vertex_cache = false;
+		else if(arg == "--no-fetch")
+			opts.vertex_fetch = false;
+		else if(arg == "--no-strips")
+			opts.strips = false;
+		else
+			paths.push_back(arg);
+	}
+
+	if(paths.empty())
+	{
+		printf("usage: %s <flver>... [--cache n] [--no-cache] [--no-fetch] [--no-strips]\n",argv[0]);
+		return 1;
+	}
+
+	totals_t totals;
+	i32 failed = 0;
+	for(const std::string& path : paths)
+		failed += !run(path,opts,cache_size,totals);
+
+	if(paths.size() > 1 && totals.faces > 0)
+		printf("total: %lld faces, acmr %.3f -> %.3f on a %d vertex fifo\n",
+			(long long)totals.faces,totals.before / totals.faces,totals.after / totals.faces,cache_size
+		);
+	return failed ? 1 : 0;
+};
\ No newline at end of file
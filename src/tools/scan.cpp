@@ -0,0 +1,286 @@
+#include "../common.h"
+#include "../binder/binder.h"
+#include "../formats/dcx.h"
+#include "../util/thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+/*
+	inventories every container under a directory. each file's magic is
+	probed and its header parsed on a work stealing pool, directories are
+	walked on the same pool. dcx files only inflate as far as the header
+	of what they hold. prints one row per recognised file as csv or
+	json and the throughput to stderr
+*/
+
+namespace fs = std::filesystem;
+
+struct summary_t
+{
+	std::string path;
+	std::string format;      //magic of the file itself
+	std::string compression; //dcx format, empty when stored raw
+	std::string inner;       //magic of what the dcx holds
+	i64 entries = -1;        //binder entries or flver meshes, -1 if unknown
+	i64 size = 0;
+	i64 uncompressed = 0;
+	std::string error = "";
+};
+
+static std::string magic_of(UMEM* mem)
+{
+	char m[6] = {};
+	if(mem->read_at(m,6,0) < 4)
+		return "";
+	if(memcmp(m,"FLVER\0",6) == 0)
+		return "FLVER";
+	for(const char* known : {"DCX\0","BND3","BND4","BHF3","BHF4"})
+		if(memcmp(m,known,4) == 0)
+			return std::string(known,strnlen(known,4));
+	return "";
+};
+
+//payload inflated for a dcx's inner header at first, more only if the header runs past it
+static const i64 PROBE_BYTES = 0x10000;
+
+//fills in the entry count of whatever format mem holds
+static void probe_payload(UMEM* mem, const std::string& format, summary_t& s)
+{
+	if(format == "FLVER")
+	{
+		//flver2 keeps its mesh count at 0x20, endian marked at 0x06
+		char endian = 0;
+		u32 meshes = 0;
+		mem->read_at(&endian,1,6);
+		mem->read_at(&meshes,4,0x20);
+		s.entries = endian == 'B' ? __builtin_bswap32(meshes) : meshes;
+		return;
+	}
+
+	if(format.empty() || format == "DCX")
+		return;
+
+	//quietly, stdout may be the inventory itself
+	mem->seek(0,SEEK_SET);
+	std::string error = "";
+	binder_t* bnd = binder_t::read(mem,&error);
+	if(bnd != nullptr)
+		s.entries = bnd->get_headers().size();
+	else
+		s.error = error.empty() ? "bad "+format+" header" : error;
+	delete bnd;
+};
+
+static void probe(const fs::path& path, summary_t& s)
+{
+	UMEM* mem = uopen(path.string(),"rb");
+	if(!mem->can_read())
+	{
+		uclose(mem);
+		s.error = "can't open";
+		return;
+	}
+	s.size = usize(mem);
+	s.uncompressed = s.size;
+
+	try
+	{
+		if(s.format == "DCX")
+		{
+			dcx_t* dcx = dcx_t::open(mem);
+			s.compression = std::string(dcx->format());
+			s.uncompressed = dcx->uncompressed_size();
+
+			//inflate just enough for the inner header, doubling until it parses or the payload runs out
+			for(i64 want = PROBE_BYTES; ; want *= 2)
+			{
+				UMEM* inner = uopen(0);
+				summary_t attempt = s;
+				bool whole = true; //a failed inflate won't do better with more
+				try
+				{
+					dcx->decompress(inner,want);
+					whole = usize(inner) < want || usize(inner) >= s.uncompressed;
+					attempt.inner = magic_of(inner);
+					probe_payload(inner,attempt.inner,attempt);
+				}
+				catch(std::exception& e)
+				{
+					attempt.error = e.what();
+				}
+				uclose(inner);
+				if(attempt.error.empty() || whole)
+				{
+					s = attempt;
+					break;
+				}
+			}
+			delete dcx;
+		}
+		else
+		{
+			probe_payload(mem,s.format,s);
+		}
+	}
+	catch(std::exception& e)
+	{
+		s.error = e.what();
+	}
+	uclose(mem);
+
+	while(!s.error.empty() && (s.error.back() == '\n' || s.error.back() == '\r'))
+		s.error.pop_back();
+};
+
+//csv doubles quotes and may hold line breaks inside them, json can't hold control characters at all
+static std::string escape(const std::string& str, bool json)
+{
+	std::string out;
+	for(char c : str)
+	{
+		if(!json)
+		{
+			if(c == '"')
+				out.push_back('"');
+			out.push_back(c);
+		}
+		else if(c == '"' || c == '\\')
+		{
+			out.push_back('\\');
+			out.push_back(c);
+		}
+		else if(c == '\n')
+			out += "\\n";
+		else if(c == '\r')
+			out += "\\r";
+		else if(c == '\t')
+			out += "\\t";
+		else if((u8)c < 0x20)
+		{
+			char hex[8];
+			snprintf(hex,sizeof(hex),"\\u%04x",(u8)c);
+			out += hex;
+		}
+		else
+			out.push_back(c);
+	}
+	return out;
+};
+
+static void print(FILE* out, const std::vector<summary_t>& rows, bool json)
+{
+	if(!json)
+		fprintf(out,"path,format,compression,inner,entries,size,uncompressed,error\n");
+	else
+		fprintf(out,"[\n");
+
+	for(size_t i = 0; i < rows.size(); i++)
+	{
+		const summary_t& r = rows[i];
+		if(json)
+			fprintf(out,
+				"\t{\"path\":\"%s\",\"format\":\"%s\",\"compression\":\"%s\",\"inner\":\"%s\","
+				"\"entries\":%lld,\"size\":%lld,\"uncompressed\":%lld,\"error\":\"%s\"}%s\n",
+				escape(r.path,true).c_str(),r.format.c_str(),escape(r.compression,true).c_str(),r.inner.c_str(),
+				(long long)r.entries,(long long)r.size,(long long)r.uncompressed,
+				escape(r.error,true).c_str(),i + 1 < rows.size() ? "," : ""
+			);
+		else
+			fprintf(out,"\"%s\",%s,\"%s\",%s,%lld,%lld,%lld,\"%s\"\n",
+				escape(r.path,false).c_str(),r.format.c_str(),escape(r.compression,false).c_str(),r.inner.c_str(),
+				(long long)r.entries,(long long)r.size,(long long)r.uncompressed,
+				escape(r.error,false).c_str()
+			);
+	}
+
+	if(json)
+		fprintf(out,"]\n");
+};
+
+int main(int argc, const char** argv)
+{
+	std::string root = "";
+	std::string output = "";
+	bool json = false;
+	i32 threads = 0;
+
+	for(i32 i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if(arg == "--json")
+			json = true;
+		else if(arg == "--csv")
+			json = false;
+		else if(arg == "--threads" && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if(arg == "-o" && i + 1 < argc)
+			output = argv[++i];
+		else
+			root = arg;
+	}
+
+	if(root.empty())
+	{
+		printf("usage: %s <dir> [--csv|--json] [--threads n] [-o file]\n",argv[0]);
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	thread_pool_t pool(threads);
+	std::mutex mutex;
+	std::vector<summary_t> rows;
+	std::atomic<i64> files = 0;
+	std::atomic<i64> bytes = 0;
+
+	pool.parallel_work<fs::path>({fs::path(root)},[&](fs::path& path, const std::function<void(fs::path)>& push)
+	{
+		std::error_code err;
+		if(fs::is_directory(path,err))
+		{
+			for(fs::directory_iterator it(path,err), end; !err && it != end; it.increment(err))
+				push(it->path());
+			return;
+		}
+		if(!fs::is_regular_file(path,err))
+			return;
+
+		files++;
+		summary_t s;
+		{
+			UMEM* mem = uopen(path.string(),"rb");
+			if(mem->can_read())
+				s.format = magic_of(mem);
+			uclose(mem);
+		}
+		if(s.format.empty())
+			return;
+
+		s.path = fs::relative(path,root,err).generic_string();
+		probe(path,s);
+		bytes += s.size;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		rows.push_back(std::move(s));
+	});
+
+	std::sort(rows.begin(),rows.end(),[](const summary_t& a, const summary_t& b){return a.path < b.path;});
+
+	FILE* out = stdout;
+	if(!output.empty() && (out = fopen(output.c_str(),"w")) == nullptr)
+	{
+		printf("Can't open %s\n",output.c_str());
+		return 1;
+	}
+	print(out,rows,json);
+	if(out != stdout)
+		fclose(out);
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	fprintf(stderr,"%lld files, %zu containers, %.1f MiB in %.3fs on %d threads: %.0f files/s, %.1f MiB/s\n",
+		(long long)files.load(),rows.size(),bytes / 1048576.0,seconds,pool.size(),
+		files / seconds,bytes / 1048576.0 / seconds
+	);
+	return 0;
+};
\ No newline at end of file
@@ -0,0 +1,431 @@
+#pragma once
+#include "../common.h"
+#include "umem.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#ifndef WIN32
+#include <unistd.h>
+#endif
+#ifdef ENABLE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+/*
+	batched positional reads for pulling many entries out of one file.
+	reads go through io_uring where the kernel allows it, otherwise each
+	worker preads on its own. either way completed reads are handed to the
+	pool's threads as they land, so decompression overlaps the i/o
+*/
+
+struct io_request_t
+{
+	i64 offset = 0;
+	i64 size = 0;
+};
+
+#ifdef ENABLE_IO_URING
+//the bare minimum of an io_uring: one submission and one completion ring
+class uring_t
+{
+	i32 m_fd = -1;
+	u32 m_entries = 0;
+	u32 m_queued = 0; //sqes written but not yet submitted
+
+	u8* m_sq = nullptr;
+	size_t m_sq_size = 0;
+	u8* m_cq = nullptr;
+	size_t m_cq_size = 0;
+	io_uring_sqe* m_sqes = nullptr;
+	size_t m_sqes_size = 0;
+
+	u32* m_sq_head = nullptr;
+	u32* m_sq_tail = nullptr;
+	u32* m_sq_mask = nullptr;
+	u32* m_sq_array = nullptr;
+	u32* m_cq_head = nullptr;
+	u32* m_cq_tail = nullptr;
+	u32* m_cq_mask = nullptr;
+	io_uring_cqe* m_cqes = nullptr;
+
+	public:
+	uring_t() = default;
+	uring_t(const uring_t&) = delete;
+	uring_t& operator=(const uring_t&) = delete;
+
+	~uring_t()
+	{
+		if(m_sqes != nullptr)
+			munmap(m_sqes,m_sqes_size);
+		if(m_cq != nullptr && m_cq != m_sq)
+			munmap(m_cq,m_cq_size);
+		if(m_sq != nullptr)
+			munmap(m_sq,m_sq_size);
+		if(m_fd >= 0)
+			close(m_fd);
+	};
+
+	//false if the kernel doesn't offer io_uring, or forbids it
+	bool init(u32 entries)
+	{
+		io_uring_params p;
+		memset(&p,0,sizeof(p));
+		m_fd = syscall(__NR_io_uring_setup,entries,&p);
+		if(m_fd < 0)
+			return false;
+		m_entries = p.sq_entries;
+
+		m_sq_size = p.sq_off.array + p.sq_entries * sizeof(u32);
+		m_cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+		bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+		if(single)
+			m_sq_size = m_cq_size = std::max(m_sq_size,m_cq_size);
+
+		void* sq = mmap(nullptr,m_sq_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,m_fd,IORING_OFF_SQ_RING);
+		if(sq == MAP_FAILED)
+			return false;
+		m_sq = (u8*)sq;
+
+		if(single)
+		{
+			m_cq = m_sq;
+		}
+		else
+		{
+			void* cq = mmap(nullptr,m_cq_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,m_fd,IORING_OFF_CQ_RING);
+			if(cq == MAP_FAILED)
+				return false;
+			m_cq = (u8*)cq;
+		}
+
+		m_sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+		void* sqes = mmap(nullptr,m_sqes_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,m_fd,IORING_OFF_SQES);
+		if(sqes == MAP_FAILED)
+			return false;
+		m_sqes = (io_uring_sqe*)sqes;
+
+		m_sq_head = (u32*)(m_sq + p.sq_off.head);
+		m_sq_tail = (u32*)(m_sq + p.sq_off.tail);
+		m_sq_mask = (u32*)(m_sq + p.sq_off.ring_mask);
+		m_sq_array = (u32*)(m_sq + p.sq_off.array);
+		m_cq_head = (u32*)(m_cq + p.cq_off.head);
+		m_cq_tail = (u32*)(m_cq + p.cq_off.tail);
+		m_cq_mask = (u32*)(m_cq + p.cq_off.ring_mask);
+		m_cqes = (io_uring_cqe*)(m_cq + p.cq_off.cqes);
+		return true;
+	};
+
+	u32 entries() const {return m_entries;};
+
+	//queues a read, false if the submission ring is full
+	bool read(i32 fd, void* dst, u32 size, i64 offset, u64 user)
+	{
+		u32 tail = *m_sq_tail;
+		if(tail - __atomic_load_n(m_sq_head,__ATOMIC_ACQUIRE) >= m_entries)
+			return false;
+
+		u32 at = tail & *m_sq_mask;
+		io_uring_sqe* sqe = &m_sqes[at];
+		memset(sqe,0,sizeof(*sqe));
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = fd;
+		sqe->addr = (u64)dst;
+		sqe->len = size;
+		sqe->off = offset;
+		sqe->user_data = user;
+		m_sq_array[at] = at;
+		__atomic_store_n(m_sq_tail,tail + 1,__ATOMIC_RELEASE);
+		m_queued++;
+		return true;
+	};
+
+	//submits queued reads and waits for at least wait completions, 0 on success
+	i32 submit(u32 wait)
+	{
+		while(true)
+		{
+			i32 r = syscall(__NR_io_uring_enter,m_fd,m_queued,wait,wait > 0 ? IORING_ENTER_GETEVENTS : 0,nullptr,0);
+			if(r >= 0)
+			{
+				m_queued -= std::min<u32>(r,m_queued);
+				return 0;
+			}
+			if(errno != EINTR)
+				return -1;
+		}
+	};
+
+	//takes one completion, false if none are ready
+	bool complete(u64& user, i32& result)
+	{
+		u32 head = *m_cq_head;
+		if(head == __atomic_load_n(m_cq_tail,__ATOMIC_ACQUIRE))
+			return false;
+		io_uring_cqe* cqe = &m_cqes[head & *m_cq_mask];
+		user = cqe->user_data;
+		result = cqe->res;
+		__atomic_store_n(m_cq_head,head + 1,__ATOMIC_RELEASE);
+		return true;
+	};
+};
+#endif
+
+class async_reader_t
+{
+	i32 m_depth = 32;
+	thread_pool_t m_pool;
+#ifdef ENABLE_IO_URING
+	uring_t m_ring;
+	bool m_uring = false;
+#endif
+
+	//the largest single read handed to the kernel, longer ones continue
+	static constexpr i64 MAX_READ = (i64)1 << 30;
+
+	//reads each request with pread straight from the workers
+	i32 read_sync(i32 fd, const std::vector<io_request_t>& requests, const std::function<void(i64,UMEM*)>& done)
+	{
+		std::atomic<i32> failed = 0;
+		m_pool.parallel_for(requests.size(),[&](i64 i)
+		{
+			const io_request_t& req = requests[i];
+			UMEM* mem = uopen(req.size);
+			i64 got = 0;
+			while(got < req.size)
+			{
+#ifdef WIN32
+				i64 r = -1;
+#else
+				i64 r = pread(fd,mem->m_data + got,std::min(req.size - got,MAX_READ),req.offset + got);
+				if(r < 0 && errno == EINTR)
+					continue;
+#endif
+				if(r <= 0)
+					break;
+				got += r;
+			}
+			if(got != req.size)
+			{
+				uclose(mem);
+				mem = nullptr;
+				failed++;
+			}
+			done(i,mem);
+		});
+		return failed > 0 ? -1 : 0;
+	};
+
+#ifdef ENABLE_IO_URING
+	/*
+		one thread keeps up to m_depth reads in the ring and queues what
+		completes, the rest of the pool takes reads off that queue. when the
+		queue backs up the i/o thread works through it too, which also covers
+		a pool of one
+	*/
+	i32 read_uring(i32 fd, const std::vector<io_request_t>& requests, const std::function<void(i64,UMEM*)>& done)
+	{
+		struct flight_t
+		{
+			i64 index = -1;
+			UMEM* mem = nullptr;
+			i64 got = 0;
+		};
+
+		std::mutex mutex;
+		std::condition_variable ready_cv;
+		std::deque<std::pair<i64,UMEM*>> ready;
+		bool finished = false;
+		std::atomic<bool> driver = false;
+		std::atomic<i32> failed = 0;
+
+		auto take = [&](std::unique_lock<std::mutex>& lock) -> bool
+		{
+			if(ready.empty())
+				return false;
+			std::pair<i64,UMEM*> item = ready.front();
+			ready.pop_front();
+			lock.unlock();
+			done(item.first,item.second);
+			lock.lock();
+			return true;
+		};
+
+		auto drive = [&]()
+		{
+			std::vector<flight_t> flights(std::min<i64>(m_ring.entries(),m_depth));
+			std::vector<i32> free_slots;
+			for(i32 i = flights.size() - 1; i >= 0; i--)
+				free_slots.push_back(i);
+
+			auto finish = [&](flight_t& f, bool ok)
+			{
+				if(!ok)
+				{
+					uclose(f.mem);
+					f.mem = nullptr;
+					failed++;
+				}
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					ready.emplace_back(f.index,f.mem);
+				}
+				ready_cv.notify_one();
+				f = flight_t();
+			};
+
+			auto queue = [&](i32 slot) -> bool
+			{
+				flight_t& f = flights[slot];
+				const io_request_t& req = requests[f.index];
+				u32 size = std::min(req.size - f.got,MAX_READ);
+				return m_ring.read(fd,f.mem->m_data + f.got,size,req.offset + f.got,slot);
+			};
+
+			i64 next = 0;
+			i64 in_flight = 0;
+			while(next < requests.size() || in_flight > 0)
+			{
+				//don't read further ahead than the workers keep up with
+				size_t backlog;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					backlog = ready.size();
+					if(backlog >= flights.size() || (m_pool.size() == 1 && backlog > 0))
+					{
+						take(lock);
+						continue;
+					}
+				}
+
+				while(!free_slots.empty() && next < requests.size())
+				{
+					i32 slot = free_slots.back();
+					flight_t& f = flights[slot];
+					f.index = next++;
+					f.mem = uopen(requests[f.index].size);
+					if(requests[f.index].size == 0)
+					{
+						finish(f,true);
+						continue;
+					}
+					free_slots.pop_back();
+					in_flight++;
+					if(!queue(slot))
+						throw std::runtime_error("async_reader_t: submission ring full\n");
+				}
+
+				if(in_flight == 0)
+					continue;
+				if(m_ring.submit(1) != 0)
+					throw std::runtime_error("async_reader_t: io_uring_enter failed\n");
+
+				u64 slot;
+				i32 result;
+				while(m_ring.complete(slot,result))
+				{
+					flight_t& f = flights[slot];
+					if(result > 0)
+						f.got += result;
+					if(result > 0 && f.got < requests[f.index].size)
+					{
+						//short read, ask for the rest
+						if(!queue(slot))
+							throw std::runtime_error("async_reader_t: submission ring full\n");
+						continue;
+					}
+					finish(f,result > 0);
+					free_slots.push_back(slot);
+					in_flight--;
+				}
+			}
+		};
+
+		try
+		{
+			m_pool.parallel_for(m_pool.size(),[&](i64)
+			{
+				if(!driver.exchange(true))
+				{
+					try
+					{
+						drive();
+					}
+					catch(...)
+					{
+						{
+							std::lock_guard<std::mutex> lock(mutex);
+							finished = true;
+						}
+						ready_cv.notify_all();
+						throw;
+					}
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						finished = true;
+					}
+					ready_cv.notify_all();
+				}
+
+				std::unique_lock<std::mutex> lock(mutex);
+				while(true)
+				{
+					ready_cv.wait(lock,[&]{return finished || !ready.empty();});
+					if(!take(lock) && finished)
+						break;
+				}
+			});
+		}
+		catch(...)
+		{
+			for(auto& item : ready)
+				uclose(item.second);
+			throw;
+		}
+		return failed > 0 ? -1 : 0;
+	};
+#endif
+
+	public:
+	//depth is how many reads are kept in flight, threads as for thread_pool_t
+	async_reader_t(i32 depth = 32, i32 threads = 0) : m_depth(std::max(1,depth)), m_pool(threads)
+	{
+#ifdef ENABLE_IO_URING
+		m_uring = m_ring.init(m_depth);
+#endif
+	};
+
+	async_reader_t(const async_reader_t&) = delete;
+	async_reader_t& operator=(const async_reader_t&) = delete;
+
+	bool uses_io_uring() const
+	{
+#ifdef ENABLE_IO_URING
+		return m_uring;
+#else
+		return false;
+#endif
+	};
+
+	i32 depth() const {return m_depth;};
+
+	i32 threads() const {return m_pool.size();};
+
+	/*
+		reads every request from fd. done(i,data) runs on the pool as each
+		read completes and owns data, which is nullptr if that read failed.
+		one read() per reader at a time. returns 0 if every read succeeded
+	*/
+	i32 read(i32 fd, const std::vector<io_request_t>& requests, const std::function<void(i64,UMEM*)>& done)
+	{
+#ifdef ENABLE_IO_URING
+		if(m_uring)
+			return read_uring(fd,requests,done);
+#endif
+		return read_sync(fd,requests,done);
+	};
+};
\ No newline at end of file
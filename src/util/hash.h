@@ -0,0 +1,148 @@
+#pragma once
+#include "../common.h"
+
+/*
+	xxh64, for telling payloads apart quickly. the state can be fed in
+	pieces so large entries don't have to be held in memory to be hashed
+*/
+
+class xxh64_t
+{
+	static constexpr u64 P1 = 0x9E3779B185EBCA87ULL;
+	static constexpr u64 P2 = 0xC2B2AE3D27D4EB4FULL;
+	static constexpr u64 P3 = 0x165667B19E3779F9ULL;
+	static constexpr u64 P4 = 0x85EBCA77C2B2AE63ULL;
+	static constexpr u64 P5 = 0x27D4EB2F165667C5ULL;
+
+	u64 m_acc[4];
+	u64 m_seed = 0;
+	u64 m_total = 0;
+	u8 m_buf[32];
+	i32 m_buf_size = 0;
+
+	static u64 rotl(u64 x, i32 r) {return (x << r) | (x >> (64 - r));};
+
+	static u64 load64(const u8* p)
+	{
+		u64 v;
+		memcpy(&v,p,8);
+		return v;
+	};
+
+	static u32 load32(const u8* p)
+	{
+		u32 v;
+		memcpy(&v,p,4);
+		return v;
+	};
+
+	static u64 round(u64 acc, u64 in)
+	{
+		acc += in * P2;
+		acc = rotl(acc,31);
+		return acc * P1;
+	};
+
+	static u64 merge(u64 acc, u64 v)
+	{
+		acc ^= round(0,v);
+		return acc * P1 + P4;
+	};
+
+	void stripe(const u8* p)
+	{
+		m_acc[0] = round(m_acc[0],load64(p));
+		m_acc[1] = round(m_acc[1],load64(p+8));
+		m_acc[2] = round(m_acc[2],load64(p+16));
+		m_acc[3] = round(m_acc[3],load64(p+24));
+	};
+
+	public:
+	xxh64_t(u64 seed = 0)
+	{
+		m_seed = seed;
+		m_acc[0] = seed + P1 + P2;
+		m_acc[1] = seed + P2;
+		m_acc[2] = seed;
+		m_acc[3] = seed - P1;
+	};
+
+	void update(const void* data, size_t len)
+	{
+		const u8* p = (const u8*)data;
+		m_total += len;
+
+		if(m_buf_size + len < 32)
+		{
+			memcpy(m_buf+m_buf_size,p,len);
+			m_buf_size += len;
+			return;
+		}
+
+		if(m_buf_size > 0)
+		{
+			size_t fill = 32 - m_buf_size;
+			memcpy(m_buf+m_buf_size,p,fill);
+			stripe(m_buf);
+			p += fill;
+			len -= fill;
+			m_buf_size = 0;
+		}
+
+		for(; len >= 32; p += 32, len -= 32)
+			stripe(p);
+
+		memcpy(m_buf,p,len);
+		m_buf_size = len;
+	};
+
+	u64 digest() const
+	{
+		u64 h;
+		if(m_total >= 32)
+		{
+			h = rotl(m_acc[0],1) + rotl(m_acc[1],7) + rotl(m_acc[2],12) + rotl(m_acc[3],18);
+			for(i32 i = 0; i < 4; i++)
+				h = merge(h,m_acc[i]);
+		}
+		else
+		{
+			h = m_seed + P5;
+		}
+		h += m_total;
+
+		const u8* p = m_buf;
+		i32 len = m_buf_size;
+		for(; len >= 8; p += 8, len -= 8)
+		{
+			h ^= round(0,load64(p));
+			h = rotl(h,27) * P1 + P4;
+		}
+		if(len >= 4)
+		{
+			h ^= (u64)load32(p) * P1;
+			h = rotl(h,23) * P2 + P3;
+			p += 4;
+			len -= 4;
+		}
+		for(; len > 0; p++, len--)
+		{
+			h ^= *p * P5;
+			h = rotl(h,11) * P1;
+		}
+
+		h ^= h >> 33;
+		h *= P2;
+		h ^= h >> 29;
+		h *= P3;
+		h ^= h >> 32;
+		return h;
+	};
+};
+
+inline u64 xxh64(const void* data, size_t len, u64 seed = 0)
+{
+	xxh64_t h(seed);
+	h.update(data,len);
+	return h.digest();
+};
\ No newline at end of file
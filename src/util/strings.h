@@ -1,7 +1,12 @@
 #pragma once
 #include "../common.h"
 #include <iconv.h>
+#include <errno.h>
 #include <stdexcept>
+#include <string_view>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
 
 inline bool same_str(std::string a, std::string b)
 {
@@ -15,71 +20,308 @@ inline bool same_str(std::string a, std::string b)
 
 namespace str_conv
 {
-	inline std::string __conv(std::string src, std::string src_fmt, std::string dst_fmt)
+	/*
+		iconv descriptors are expensive to open, so each thread keeps the ones
+		it has used open until it exits. only needed for shift-jis, utf-16 is
+		transcoded directly.
+	*/
+	struct iconv_cache_t
 	{
-		i32 len = src.length();
-		char p_src[4096];
-		char p_dst[4096];
-		memset(p_src,0,sizeof(char)*4096);
-		memset(p_dst,0,sizeof(char)*4096);
-		for(i32 i = 0; i < len; i++)
-			p_src[i] = src[i];
-		size_t n_src = len;
-		size_t n_dst = len * 4;
+		struct entry_t
+		{
+			std::string dst_fmt;
+			std::string src_fmt;
+			iconv_t icd;
+		};
+
+		std::vector<entry_t> entries = {};
 
-		char* ps = p_src;
-		char* pd = p_dst;
+		~iconv_cache_t()
+		{
+			for(i32 i = 0; i < entries.size(); i++)
+				iconv_close(entries[i].icd);
+		};
+
+		iconv_t get(const char* dst_fmt, const char* src_fmt)
+		{
+			for(i32 i = 0; i < entries.size(); i++)
+				if(entries[i].dst_fmt == dst_fmt && entries[i].src_fmt == src_fmt)
+					return entries[i].icd;
+
+			iconv_t icd = iconv_open(dst_fmt,src_fmt);
+			if(icd == (iconv_t)-1)
+				throw std::runtime_error("Failed to open iconv!\n");
+			entries.push_back({dst_fmt,src_fmt,icd});
+			return icd;
+		};
+	};
+
+	inline iconv_t __get_iconv(const char* dst_fmt, const char* src_fmt)
+	{
+		thread_local iconv_cache_t cache;
+		return cache.get(dst_fmt,src_fmt);
+	};
 
-		iconv_t icd = iconv_open(src_fmt.c_str(),dst_fmt.c_str());
-		if(icd == (iconv_t)-1)
-			throw std::runtime_error("Failed to open iconv!\n");
+	//length of the leading run of 7-bit ascii bytes
+	inline size_t ascii_prefix(const char* str, size_t len)
+	{
+		size_t i = 0;
+#if defined(__AVX2__)
+		for(; i + 32 <= len; i += 32)
+		{
+			u32 mask = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(str+i)));
+			if(mask != 0)
+				return i + __builtin_ctz(mask);
+		}
+#elif defined(__SSE2__)
+		for(; i + 16 <= len; i += 16)
+		{
+			u32 mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(str+i)));
+			if(mask != 0)
+				return i + __builtin_ctz(mask);
+		}
+#endif
+		for(; i < len; i++)
+			if((u8)str[i] & 0x80)
+				return i;
+		return len;
+	};
 
-		if(iconv(icd,&ps,&n_src,&pd,&n_dst) == (size_t)-1)
-			throw std::runtime_error("Failed to run iconv!\n");
+	inline bool is_ascii(std::string_view str)
+	{
+		return ascii_prefix(str.data(),str.size()) == str.size();
+	};
 
-		p_dst[len*4+1-n_dst] = 0;
-		//printf("p_dst: %s\n",p_dst);
+	inline std::string __conv(std::string_view src, const char* src_fmt, const char* dst_fmt)
+	{
+		iconv_t icd = __get_iconv(dst_fmt,src_fmt);
+		iconv(icd,nullptr,nullptr,nullptr,nullptr); //reset shift state
 
 		std::string out;
-		i32 i = 0;
-		while(true)
+		out.resize(src.size() * 2 + 16);
+		size_t used = 0;
+
+		char* ps = (char*)src.data();
+		size_t n_src = src.size();
+
+		while(n_src > 0)
 		{
-			char c = p_dst[i];
-			if(c == '\0')
-				break;
-			out.push_back(c);
-			i++;
-			if(i > len * 4)
-				throw std::runtime_error("__conv(): "+src_fmt+" to "+dst_fmt+" overflow!\n");
+			char* pd = out.data() + used;
+			size_t n_dst = out.size() - used;
+			size_t ret = iconv(icd,&ps,&n_src,&pd,&n_dst);
+			used = pd - out.data();
+
+			if(ret == (size_t)-1)
+			{
+				if(errno == E2BIG)
+				{
+					out.resize(out.size() * 2);
+					continue;
+				}
+				throw std::runtime_error(
+					"__conv(): "+std::string(src_fmt)+" to "+std::string(dst_fmt)+" failed!\n"
+				);
+			}
 		}
 
-		iconv_close(icd);
+		out.resize(used);
 		return out;
 	};
 
-	inline std::string utf16_to_utf8(std::string str, bool big_endian)
+	inline u16 __load_u16(const char* p, bool big_endian)
+	{
+		u8 a = p[0];
+		u8 b = p[1];
+		return big_endian ? (a << 8) | b : (b << 8) | a;
+	};
+
+	inline void __store_u16(char* p, u16 u, bool big_endian)
+	{
+		p[0] = big_endian ? u >> 8 : u & 0xFF;
+		p[1] = big_endian ? u & 0xFF : u >> 8;
+	};
+
+	//encodes a code point, returns bytes written
+	inline i32 __put_utf8(char* p, u32 c)
+	{
+		if(c < 0x80)
+		{
+			p[0] = c;
+			return 1;
+		}
+		if(c < 0x800)
+		{
+			p[0] = 0xC0 | (c >> 6);
+			p[1] = 0x80 | (c & 0x3F);
+			return 2;
+		}
+		if(c < 0x10000)
+		{
+			p[0] = 0xE0 | (c >> 12);
+			p[1] = 0x80 | ((c >> 6) & 0x3F);
+			p[2] = 0x80 | (c & 0x3F);
+			return 3;
+		}
+		p[0] = 0xF0 | (c >> 18);
+		p[1] = 0x80 | ((c >> 12) & 0x3F);
+		p[2] = 0x80 | ((c >> 6) & 0x3F);
+		p[3] = 0x80 | (c & 0x3F);
+		return 4;
+	};
+
+	//decodes a code point at str[i], advancing i. bad sequences become U+FFFD
+	inline u32 __get_utf8(const u8* str, size_t len, size_t& i)
+	{
+		u8 b = str[i++];
+		if(b < 0x80)
+			return b;
+
+		i32 extra = 0;
+		u32 c = 0;
+		if((b & 0xE0) == 0xC0)
+		{
+			extra = 1;
+			c = b & 0x1F;
+		}
+		else if((b & 0xF0) == 0xE0)
+		{
+			extra = 2;
+			c = b & 0x0F;
+		}
+		else if((b & 0xF8) == 0xF0)
+		{
+			extra = 3;
+			c = b & 0x07;
+		}
+		else
+		{
+			return 0xFFFD;
+		}
+
+		for(i32 j = 0; j < extra; j++)
+		{
+			if(i >= len || (str[i] & 0xC0) != 0x80)
+				return 0xFFFD;
+			c = (c << 6) | (str[i++] & 0x3F);
+		}
+		return c;
+	};
+
+	inline std::string utf16_to_utf8(std::string_view str, bool big_endian)
 	{
-		std::string fmt = "UTF-16";
-		if(big_endian)
-			fmt = "UTF-16BE";
-		return __conv(str,fmt,"UTF-8");
+		const char* src = str.data();
+		size_t n = str.size() / 2;
+
+		std::string out;
+		out.resize(n * 3);
+		char* dst = out.data();
+
+		size_t i = 0;
+		while(i < n)
+		{
+#ifdef __SSE4_1__
+			//copy runs of 8 ascii code units at a time
+			const __m128i swap = _mm_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+			const __m128i high = _mm_set1_epi16((i16)0xFF80);
+			for(; i + 8 <= n; i += 8)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i*)(src+i*2));
+				if(big_endian)
+					v = _mm_shuffle_epi8(v,swap);
+				if(!_mm_testz_si128(v,high))
+					break;
+				_mm_storel_epi64((__m128i*)dst,_mm_packus_epi16(v,v));
+				dst += 8;
+			}
+			if(i >= n)
+				break;
+#endif
+			u32 c = __load_u16(src+i*2,big_endian);
+			i++;
+			if(c >= 0xD800 && c < 0xDC00 && i < n)
+			{
+				u32 lo = __load_u16(src+i*2,big_endian);
+				if(lo >= 0xDC00 && lo < 0xE000)
+				{
+					c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+					i++;
+				}
+				else
+				{
+					c = 0xFFFD;
+				}
+			}
+			else if(c >= 0xD800 && c < 0xE000)
+			{
+				c = 0xFFFD;
+			}
+			dst += __put_utf8(dst,c);
+		}
+
+		out.resize(dst - out.data());
+		return out;
 	};
 
-	inline std::string shift_jis_to_utf8(std::string str)
+	inline std::string shift_jis_to_utf8(std::string_view str)
 	{
-		return __conv(str,"Shift_JIS","UTF-8");
+		//game paths use cp932, where 0x5C is a backslash rather than a yen sign
+		if(is_ascii(str))
+			return std::string(str);
+		return __conv(str,"CP932","UTF-8");
 	};
 
-	inline std::string utf8_to_utf16(std::string str, bool big_endian)
+	inline std::string utf8_to_utf16(std::string_view str, bool big_endian)
 	{
-		std::string fmt = "UTF-16";
-		if(big_endian)
-			fmt = "UTF-16BE";
-		return __conv(str,"UTF-8",fmt);
+		const u8* src = (const u8*)str.data();
+		size_t n = str.size();
+
+		std::string out;
+		out.resize(n * 2);
+		char* dst = out.data();
+
+		size_t i = 0;
+		while(i < n)
+		{
+#ifdef __SSE4_1__
+			//widen runs of 8 ascii bytes at a time
+			const __m128i swap = _mm_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+			for(; i + 8 <= n; i += 8)
+			{
+				__m128i v = _mm_loadl_epi64((const __m128i*)(src+i));
+				if(_mm_movemask_epi8(v) & 0xFF)
+					break;
+				v = _mm_cvtepu8_epi16(v);
+				if(big_endian)
+					v = _mm_shuffle_epi8(v,swap);
+				_mm_storeu_si128((__m128i*)dst,v);
+				dst += 16;
+			}
+			if(i >= n)
+				break;
+#endif
+			u32 c = __get_utf8(src,n,i);
+			if(c >= 0x10000)
+			{
+				c -= 0x10000;
+				__store_u16(dst,0xD800 + (c >> 10),big_endian);
+				__store_u16(dst+2,0xDC00 + (c & 0x3FF),big_endian);
+				dst += 4;
+			}
+			else
+			{
+				__store_u16(dst,c,big_endian);
+				dst += 2;
+			}
+		}
+
+		out.resize(dst - out.data());
+		return out;
 	};
 
-	inline std::string utf8_to_shift_jis(std::string str)
+	inline std::string utf8_to_shift_jis(std::string_view str)
 	{
-		return __conv(str,"UTF-8","Shift_JIS");
+		if(is_ascii(str))
+			return std::string(str);
+		return __conv(str,"UTF-8","CP932");
 	};
-};
+};
\ No newline at end of file
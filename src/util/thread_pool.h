@@ -0,0 +1,220 @@
+#pragma once
+#include "../common.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/*
+	fixed set of worker threads for data parallel loops
+	the calling thread works alongside the pool, so a pool of size 1 runs
+	everything inline
+*/
+
+class thread_pool_t
+{
+	std::vector<std::thread> m_threads = {};
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	//current job, guarded by m_mutex except for m_next
+	const std::function<void(i64)>* m_fn = nullptr;
+	i64 m_count = 0;
+	std::atomic<i64> m_next = 0;
+	i32 m_busy = 0;
+	u64 m_job = 0;
+	bool m_stop = false;
+	std::exception_ptr m_error = nullptr;
+
+	void run_job(const std::function<void(i64)>* fn, i64 count)
+	{
+		while(true)
+		{
+			i64 i = m_next.fetch_add(1);
+			if(i >= count)
+				break;
+			try
+			{
+				(*fn)(i);
+			}
+			catch(...)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if(m_error == nullptr)
+					m_error = std::current_exception();
+				m_next = count; //stop handing out work
+			}
+		}
+	};
+
+	void worker()
+	{
+		u64 seen = 0;
+		while(true)
+		{
+			const std::function<void(i64)>* fn;
+			i64 count;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock,[&]{return m_stop || m_job != seen;});
+				if(m_stop)
+					return;
+				seen = m_job;
+				fn = m_fn;
+				count = m_count;
+				m_busy++;
+			}
+
+			//the job may already have finished before this thread woke up
+			if(fn != nullptr)
+				run_job(fn,count);
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(--m_busy == 0)
+				m_done.notify_all();
+		}
+	};
+
+	public:
+	//threads <= 0 uses every hardware thread
+	thread_pool_t(i32 threads = 0)
+	{
+		if(threads <= 0)
+			threads = std::max<i32>(1,std::thread::hardware_concurrency());
+		for(i32 i = 1; i < threads; i++)
+			m_threads.emplace_back(&thread_pool_t::worker,this);
+	};
+
+	thread_pool_t(const thread_pool_t&) = delete;
+	thread_pool_t& operator=(const thread_pool_t&) = delete;
+
+	~thread_pool_t()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		for(i32 i = 0; i < m_threads.size(); i++)
+			m_threads[i].join();
+	};
+
+	i32 size() const {return m_threads.size() + 1;};
+
+	//calls fn(i) for i in [0,count) across the pool, rethrows the first exception
+	void parallel_for(i64 count, const std::function<void(i64)>& fn)
+	{
+		if(count <= 0)
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_fn = &fn;
+			m_count = count;
+			m_next = 0;
+			m_error = nullptr;
+			m_job++;
+		}
+		m_wake.notify_all();
+
+		run_job(&fn,count);
+
+		std::exception_ptr error;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_done.wait(lock,[&]{return m_busy == 0;});
+			m_fn = nullptr;
+			error = m_error;
+		}
+		if(error != nullptr)
+			std::rethrow_exception(error);
+	};
+
+	/*
+		calls fn on every item and on everything fn pushes while handling one.
+		each thread works from the back of its own deque and steals from the
+		front of the others once it runs dry, so uneven trees such as a
+		directory walk keep every thread busy. rethrows the first exception
+	*/
+	template<typename T>
+	void parallel_work(std::vector<T> items, const std::function<void(T&, const std::function<void(T)>&)>& fn)
+	{
+		struct queue_t
+		{
+			std::mutex mutex;
+			std::deque<T> items;
+		};
+
+		i32 n = size();
+		std::vector<queue_t> queues(n);
+		for(size_t i = 0; i < items.size(); i++)
+			queues[i % n].items.push_back(std::move(items[i]));
+
+		//items pushed but not yet finished, the walk is over when it hits 0
+		std::atomic<i64> pending = items.size();
+		std::atomic<bool> abort = false;
+		std::mutex error_mutex;
+		std::exception_ptr error = nullptr;
+
+		parallel_for(n,[&](i64 self)
+		{
+			queue_t& own = queues[self];
+			std::function<void(T)> push = [&](T item)
+			{
+				pending++;
+				std::lock_guard<std::mutex> lock(own.mutex);
+				own.items.push_back(std::move(item));
+			};
+
+			while(pending > 0 && !abort)
+			{
+				bool found = false;
+				T item;
+				for(i32 i = 0; i < n && !found; i++)
+				{
+					queue_t& q = queues[(self + i) % n];
+					std::lock_guard<std::mutex> lock(q.mutex);
+					if(q.items.empty())
+						continue;
+					if(i == 0)
+					{
+						item = std::move(q.items.back());
+						q.items.pop_back();
+					}
+					else
+					{
+						item = std::move(q.items.front());
+						q.items.pop_front();
+					}
+					found = true;
+				}
+
+				if(!found)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				try
+				{
+					fn(item,push);
+				}
+				catch(...)
+				{
+					std::lock_guard<std::mutex> lock(error_mutex);
+					if(error == nullptr)
+						error = std::current_exception();
+					abort = true;
+				}
+				pending--;
+			}
+		});
+
+		if(error != nullptr)
+			std::rethrow_exception(error);
+	};
+};
\ No newline at end of file
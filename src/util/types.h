@@ -1,5 +1,6 @@
 #pragma once
 #include "../common.h"
+#include "../math/vec.h"
 
 struct color_t
 {
@@ -11,5 +12,7 @@ struct color_t
 
 struct bounding_box_t
 {
-	
+	vec3f min;
+	vec3f max;
+	vec3f unk; //only stored by newer formats
 };
\ No newline at end of file
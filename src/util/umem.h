@@ -6,7 +6,11 @@
 #include "util.h"
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <stack>
+#ifndef WIN32
+#include <unistd.h>
+#endif
 
 inline i64 block_alloc(i64 bytes, i64 block_size)
 {
@@ -68,7 +72,7 @@ struct UMEM
 		{
 			//m_code = SUCCESS;
 			m_can_read = true;
-			if(m_mode.find('w') != -1)
+			if(m_mode.find_first_of("wa+") != std::string::npos)
 				m_can_write = true;
 			fseek(m_file,0,SEEK_END);
 			m_size = ftell(m_file);
@@ -125,6 +129,8 @@ struct UMEM
 			//m_err = EOF;
 		m_stack.push(m_pos);
 		m_pos = position;
+		if(m_is_file)
+			fseek(m_file,m_pos,SEEK_SET);
 		return this;
 	};
 
@@ -132,6 +138,8 @@ struct UMEM
 	{
 		m_pos = m_stack.top();
 		m_stack.pop();
+		if(m_is_file)
+			fseek(m_file,m_pos,SEEK_SET);
 		return this;
 	};
 
@@ -144,24 +152,71 @@ struct UMEM
 			r = fread(dst,size,n,m_file);
 			m_pos += r * size;
 		}
-		else
+		else if(size > 0)
 		{
-			for(i64 i = 0; i < n; i++)
-			{
-				if(size + m_pos >= m_size)
-				{
-					m_err = EOF;
-					break;
-				}
-				
-				memcpy((char*)dst+(i*size),m_data+m_pos,size);
-				m_pos += size;
-				r += 1;
-			}
+			//copy every whole element that fits in one go
+			//a short read isn't an error, same as fread
+			r = std::max<i64>(0,std::min<i64>(n,(m_size - m_pos) / size));
+			memcpy(dst,m_data+m_pos,r*size);
+			m_pos += r * size;
 		}
 		return r;
 	};
 
+	/*
+		returns the next size bytes and advances the cursor. memory backed
+		UMEMs return a pointer into their buffer, files are read into scratch.
+		returns nullptr on a short read
+	*/
+	const u8* read_block(i64 size, std::vector<u8>& scratch)
+	{
+		const u8* p = view(m_pos,size);
+		if(p != nullptr)
+		{
+			m_pos += size;
+			return p;
+		}
+		scratch.resize(size);
+		if(read(scratch.data(),1,size) != size)
+			return nullptr;
+		return scratch.data();
+	};
+
+	//pointer into the buffer for memory backed UMEMs, nullptr for files or out of bounds
+	const u8* view(i64 position, i64 size) const
+	{
+		if(m_is_file || position < 0 || size < 0 || position + size > m_size)
+			return nullptr;
+		return m_data + position;
+	};
+
+	//positional read, does not move the cursor. returns bytes read
+	i64 read_at(void* dst, i64 size, i64 position)
+	{
+		if(!m_can_read || position < 0 || position >= m_size)
+			return 0;
+		size = std::min<i64>(size,m_size - position);
+
+		if(m_is_file)
+		{
+			if(m_can_write)
+				fflush(m_file);
+#ifdef WIN32
+			i64 prev = _ftelli64(m_file);
+			_fseeki64(m_file,position,SEEK_SET);
+			i64 r = fread(dst,1,size,m_file);
+			_fseeki64(m_file,prev,SEEK_SET);
+			return r;
+#else
+			i64 r = pread(fileno(m_file),dst,size,position);
+			return r < 0 ? 0 : r;
+#endif
+		}
+
+		memcpy(dst,m_data+position,size);
+		return size;
+	};
+
 	i64 write(void* src, i64 size, i64 n)
 	{
 		if(!m_can_write)
@@ -177,8 +232,8 @@ struct UMEM
 		}
 		else
 		{
-			if(m_size + size * n > m_size)
-				resize(m_size + size * n);
+			if(m_pos + size * n > m_size)
+				resize(m_pos + size * n);
 			memcpy(m_data+m_pos,src,size*n);
 			r = n;
 			m_pos += r * size;
@@ -220,10 +275,13 @@ struct UMEM
 		if(m_is_file)
 		{
 #ifdef WIN32
-			return _fseeki64(m_file,m_offset,whence);
+			i32 r = _fseeki64(m_file,offset,whence);
+			m_pos = _ftelli64(m_file);
 #else
-			return fseek(m_file,offset,whence);
+			i32 r = fseek(m_file,offset,whence);
+			m_pos = ftell(m_file);
 #endif
+			return r;
 		}
 		else
 		{
@@ -231,16 +289,16 @@ struct UMEM
 			{
 				default:
 				case(SEEK_SET):
-					if(offset < 0 || offset >= m_size)
+					if(offset < 0 || offset > m_size)
 						return -1;
 					m_pos = offset; return 0;
 				case(SEEK_CUR):
-					if(offset + m_pos < 0 || offset + m_pos >= m_size)
+					if(offset + m_pos < 0 || offset + m_pos > m_size)
 						return -1;
 					m_pos += offset;
 					return 0;
 				case(SEEK_END):
-					if(offset + m_size < 0 || offset + m_size >= m_size)
+					if(offset + m_size < 0 || offset > 0)
 						return -1;
 					m_pos = m_size + offset;
 					return 0;
@@ -297,41 +355,102 @@ struct UMEM
 		return false;
 	};*/
 
+	//view of a null terminated string, only valid for memory backed UMEMs
+	std::string_view read_str_view(i64 position)
+	{
+		if(m_is_file)
+			throw std::runtime_error("read_str_view: file backed UMEM!\n");
+		if(position < 0 || position >= m_size)
+			throw std::runtime_error("read_str_view: out of bounds!\n");
+
+		const char* start = (const char*)m_data + position;
+		const char* end = (const char*)memchr(start,0,m_size - position);
+		return std::string_view(start,end ? end - start : m_size - position);
+	};
+
+	//view of a string terminated by a 16-bit null, only valid for memory backed UMEMs
+	std::string_view read_str16_view(i64 position)
+	{
+		if(m_is_file)
+			throw std::runtime_error("read_str16_view: file backed UMEM!\n");
+		if(position < 0 || position >= m_size)
+			throw std::runtime_error("read_str16_view: out of bounds!\n");
+
+		i64 len = find_nul16(m_data + position,m_size - position);
+		return std::string_view((const char*)m_data + position,len);
+	};
+
 	std::string read_str(i64 position)
 	{
-		step_in(position);
+		if(!m_is_file)
+			return std::string(read_str_view(position));
+
 		std::string str = "";
-		char c = read_u8();
-		while(c != 0)
+		char block[256];
+		while(true)
 		{
-			str.push_back(c);
-			c = read_u8();
+			i64 r = read_at(block,sizeof(block),position);
+			if(r <= 0)
+				break;
+			const char* end = (const char*)memchr(block,0,r);
+			if(end != nullptr)
+			{
+				str.append(block,end - block);
+				break;
+			}
+			str.append(block,r);
+			position += r;
+		}
+		return str;
+	};
+
+	std::string read_str16(i64 position)
+	{
+		if(!m_is_file)
+			return std::string(read_str16_view(position));
+
+		std::string str = "";
+		u8 block[256];
+		while(true)
+		{
+			i64 r = read_at(block,sizeof(block),position) & ~1;
+			if(r <= 0)
+				break;
+			i64 len = find_nul16(block,r);
+			str.append((const char*)block,len);
+			if(len < r)
+				break;
+			position += r;
 		}
-		step_out();
 		return str;
 	};
 
 	void write_str(std::string str, bool terminate)
 	{
-		for(i32 i = 0; i < str.length(); i++)
-			write_u8(str[i]);
+		write(str.data(),sizeof(char),str.length());
 		if(terminate)
 			write_u8('\0');
 	};
 
 	std::string read_utf16(i64 offset)
 	{
-		return str_conv::utf16_to_utf8(read_str(offset),m_big_endian);
+		if(!m_is_file)
+			return str_conv::utf16_to_utf8(read_str16_view(offset),m_big_endian);
+		return str_conv::utf16_to_utf8(read_str16(offset),m_big_endian);
 	};
 
 	std::string read_shift_jis(i64 offset)
 	{
+		if(!m_is_file)
+			return str_conv::shift_jis_to_utf8(read_str_view(offset));
 		return str_conv::shift_jis_to_utf8(read_str(offset));
 	};
 
 	void write_utf16(std::string str, bool terminate)
 	{
-		write_str(str_conv::utf8_to_utf16(str,m_big_endian),terminate);
+		write_str(str_conv::utf8_to_utf16(str,m_big_endian),false);
+		if(terminate)
+			write_u16(0);
 	};
 
 	void write_shift_jis(std::string str, bool terminate)
@@ -809,21 +928,69 @@ struct UMEM
 	};
 
 	public:
-	void fill_i8(std::string name, i8 i) {step_in(fill(name,"i8"))->write(&i,sizeof(i),1); step_out();};
+	void fill_i8(std::string name, i8 i)
+	{
+		if(m_big_endian)
+			flip_bytes((u8*)&i,sizeof(i));
+		step_in(fill(name,"i8"))->write(&i,sizeof(i),1);
+		step_out();
+	};
 	
-	void fill_i16(std::string name, i16 i) {step_in(fill(name,"i16"))->write(&i,sizeof(i),1); step_out();};
+	void fill_i16(std::string name, i16 i)
+	{
+		if(m_big_endian)
+			flip_bytes((u8*)&i,sizeof(i));
+		step_in(fill(name,"i16"))->write(&i,sizeof(i),1);
+		step_out();
+	};
 	
-	void fill_i32(std::string name, i32 i) {step_in(fill(name,"i32"))->write(&i,sizeof(i),1); step_out();};
+	void fill_i32(std::string name, i32 i)
+	{
+		if(m_big_endian)
+			flip_bytes((u8*)&i,sizeof(i));
+		step_in(fill(name,"i32"))->write(&i,sizeof(i),1);
+		step_out();
+	};
 	
-	void fill_i64(std::string name, i64 i) {step_in(fill(name,"i64"))->write(&i,sizeof(i),1); step_out();};
+	void fill_i64(std::string name, i64 i)
+	{
+		if(m_big_endian)
+			flip_bytes((u8*)&i,sizeof(i));
+		step_in(fill(name,"i64"))->write(&i,sizeof(i),1);
+		step_out();
+	};
 	
-	void fill_u8(std::string name, u8 u) {step_in(fill(name,"u8"))->write(&u,sizeof(u),1); step_out();};
+	void fill_u8(std::string name, u8 u)
+	{
+		if(m_big_endian)
+			flip_bytes((u8*)&u,sizeof(u));
+		step_in(fill(name,"u8"))->write(&u,sizeof(u),1);
+		step_out();
+	};
 	
-	void fill_u16(std::string name, u16 u) {step_in(fill(name,"u16"))->write(&u,sizeof(u),1); step_out();};
+	void fill_u16(std::string name, u16 u)
+	{
+		if(m_big_endian)
+			flip_bytes((u8*)&u,sizeof(u));
+		step_in(fill(name,"u16"))->write(&u,sizeof(u),1);
+		step_out();
+	};
 	
-	void fill_u32(std::string name, u32 u) {step_in(fill(name,"u32"))->write(&u,sizeof(u),1); step_out();};
+	void fill_u32(std::string name, u32 u)
+	{
+		if(m_big_endian)
+			flip_bytes((u8*)&u,sizeof(u));
+		step_in(fill(name,"u32"))->write(&u,sizeof(u),1);
+		step_out();
+	};
 	
-	void fill_u64(std::string name, u64 u) {step_in(fill(name,"u64"))->write(&u,sizeof(u),1); step_out();};
+	void fill_u64(std::string name, u64 u)
+	{
+		if(m_big_endian)
+			flip_bytes((u8*)&u,sizeof(u));
+		step_in(fill(name,"u64"))->write(&u,sizeof(u),1);
+		step_out();
+	};
 
 	void pad(i32 align)
 	{
@@ -849,6 +1016,19 @@ inline UMEM* uopen(i64 bytes)
 	return new UMEM(bytes);
 };
 
+//read only window of size bytes at offset into a memory UMEM, which must outlive it
+inline UMEM* uview(UMEM* mem, i64 offset, i64 size)
+{
+	if(mem->is_file() || offset < 0 || size < 0 || offset + size > mem->m_size)
+		return nullptr;
+	UMEM* view = new UMEM(mem,0);
+	view->m_data = mem->m_data + offset;
+	view->m_pos = 0;
+	view->m_size = size;
+	view->m_big_endian = mem->m_big_endian;
+	return view;
+};
+
 inline void uclose(UMEM* mem)
 {
 	if(mem != nullptr)
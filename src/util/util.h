@@ -1,5 +1,8 @@
 #pragma once
 #include "../common.h"
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
 
 inline u8 flip_byte(u8 b)
 {
@@ -7,4 +10,24 @@ inline u8 flip_byte(u8 b)
    b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
    b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
    return b;
+};
+
+//returns the byte offset of the first 16-bit zero in p, or len if there is none
+inline i64 find_nul16(const u8* p, i64 len)
+{
+	i64 i = 0;
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	for(; i + 16 <= len; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(p+i));
+		u32 mask = _mm_movemask_epi8(_mm_cmpeq_epi16(v,zero));
+		if(mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+#endif
+	for(; i + 2 <= len; i += 2)
+		if(p[i] == 0 && p[i+1] == 0)
+			return i;
+	return len;
 };
\ No newline at end of file
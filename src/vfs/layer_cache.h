@@ -0,0 +1,183 @@
+#pragma once
+#include "../common.h"
+#include "../util/umem.h"
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+
+/*
+	process wide cache of decompressed payloads, keyed by the container they
+	came from, its modification time and where in it they start. bounded by
+	a byte budget with lru eviction. a miss loads outside the lock and any
+	other thread asking for the same key meanwhile waits for that load
+	rather than decompressing it again
+*/
+class layer_cache_t
+{
+	public:
+	struct key_t
+	{
+		std::string path;
+		i64 mtime = 0;
+		i64 offset = 0;
+
+		bool operator==(const key_t& k) const
+		{
+			return offset == k.offset && mtime == k.mtime && path == k.path;
+		};
+	};
+
+	struct stats_t
+	{
+		u64 hits = 0;
+		u64 misses = 0;
+		u64 evictions = 0;
+		u64 collapsed = 0; //requests that waited on another thread's load
+		i64 bytes = 0;
+		i64 budget = 0;
+	};
+
+	private:
+	struct key_hash_t
+	{
+		size_t operator()(const key_t& k) const
+		{
+			size_t h = std::hash<std::string>()(k.path);
+			h ^= std::hash<i64>()(k.mtime) + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+			h ^= std::hash<i64>()(k.offset) + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+			return h;
+		};
+	};
+
+	struct entry_t
+	{
+		key_t key;
+		sp<UMEM> value = nullptr;
+		i64 size = 0;
+	};
+
+	mutable std::mutex m_mutex;
+	std::list<entry_t> m_lru = {}; //most recently used first
+	std::unordered_map<key_t,std::list<entry_t>::iterator,key_hash_t> m_index = {};
+	std::unordered_map<key_t,std::shared_future<sp<UMEM>>,key_hash_t> m_loading = {};
+	stats_t m_stats = {};
+
+	//drops least recently used entries until the budget is met, m_mutex held
+	void evict()
+	{
+		while(m_stats.bytes > m_stats.budget && !m_lru.empty())
+		{
+			entry_t& old = m_lru.back();
+			m_stats.bytes -= old.size;
+			m_stats.evictions++;
+			m_index.erase(old.key);
+			m_lru.pop_back();
+		}
+	};
+
+	public:
+	layer_cache_t(i64 budget = (i64)1 << 30)
+	{
+		m_stats.budget = budget;
+	};
+
+	layer_cache_t(const layer_cache_t&) = delete;
+	layer_cache_t& operator=(const layer_cache_t&) = delete;
+
+	static layer_cache_t& global()
+	{
+		static layer_cache_t cache;
+		return cache;
+	};
+
+	/*
+		returns the cached payload for key, calling load to produce it on a
+		miss. load's exceptions reach every caller waiting on that key.
+		payloads stay valid for as long as they are held, evicted or not
+	*/
+	sp<UMEM> get_or_load(const key_t& key, const std::function<sp<UMEM>()>& load)
+	{
+		std::promise<sp<UMEM>> promise;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			auto it = m_index.find(key);
+			if(it != m_index.end())
+			{
+				m_stats.hits++;
+				m_lru.splice(m_lru.begin(),m_lru,it->second);
+				return it->second->value;
+			}
+
+			auto pending = m_loading.find(key);
+			if(pending != m_loading.end())
+			{
+				m_stats.collapsed++;
+				std::shared_future<sp<UMEM>> future = pending->second;
+				lock.unlock();
+				return future.get();
+			}
+
+			m_stats.misses++;
+			m_loading[key] = promise.get_future().share();
+		}
+
+		sp<UMEM> value = nullptr;
+		try
+		{
+			value = load();
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_loading.erase(key);
+			promise.set_exception(std::current_exception());
+			throw;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_loading.erase(key);
+			if(value != nullptr)
+			{
+				m_lru.push_front({key,value,usize(value.get())});
+				m_index[key] = m_lru.begin();
+				m_stats.bytes += m_lru.front().size;
+				evict();
+			}
+		}
+		promise.set_value(value);
+		return value;
+	};
+
+	void set_budget(i64 budget)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.budget = budget;
+		evict();
+	};
+
+	stats_t stats() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stats;
+	};
+
+	void reset_stats()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.hits = 0;
+		m_stats.misses = 0;
+		m_stats.evictions = 0;
+		m_stats.collapsed = 0;
+	};
+
+	//drops every entry, payloads still held elsewhere stay valid
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_lru.clear();
+		m_index.clear();
+		m_stats.bytes = 0;
+	};
+};
\ No newline at end of file
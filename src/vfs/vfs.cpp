@@ -0,0 +1,263 @@
+#include "vfs.h"
+#include "../formats/dcx.h"
+#include <filesystem>
+#include <stdexcept>
+
+std::vector<std::string_view> vfs_t::split(std::string_view vpath)
+{
+	std::vector<std::string_view> parts;
+	while(true)
+	{
+		size_t at = vpath.find(SEPARATOR);
+		parts.push_back(vpath.substr(0,at));
+		if(at == std::string_view::npos)
+			break;
+		vpath = vpath.substr(at + SEPARATOR.size());
+	}
+	return parts;
+};
+
+sp<vfs_t::layer_t> vfs_t::cache_get(const std::string& key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_index.find(key);
+	if(it == m_index.end())
+		return nullptr;
+	m_lru.splice(m_lru.begin(),m_lru,it->second);
+	return it->second->layer;
+};
+
+void vfs_t::cache_put(const std::string& key, sp<layer_t> layer)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_index.find(key) != m_index.end())
+		return;
+
+	m_lru.push_front({key,layer});
+	m_index[key] = m_lru.begin();
+	m_bytes += layer->cost;
+
+	//layers still in use stay alive through their shared pointers
+	while(m_bytes > m_budget && m_lru.size() > 1)
+	{
+		slot_t& old = m_lru.back();
+		m_bytes -= old.layer->cost;
+		m_index.erase(old.key);
+		m_lru.pop_back();
+	}
+};
+
+sp<vfs_t::layer_t> vfs_t::open_file(const std::string& path)
+{
+	std::error_code err;
+	auto time = std::filesystem::last_write_time(path,err);
+	if(err)
+		return nullptr;
+	i64 mtime = time.time_since_epoch().count();
+
+	UMEM* mem = uopen(path,"rb");
+	if(!mem->can_read())
+	{
+		uclose(mem);
+		return nullptr;
+	}
+
+	if(dcx_t::is_dcx(mem))
+	{
+		sp<UMEM> payload = layer_cache_t::global().get_or_load({path,mtime,0},[&]{return dcx_t::inflate(mem);});
+		uclose(mem);
+		return cached_layer(payload,mtime);
+	}
+
+	sp<layer_t> layer = std::make_shared<layer_t>();
+	layer->mem = mem;
+	layer->mtime = mtime;
+	layer->cost = 0x1000; //open files only hold a handle
+	return layer;
+};
+
+sp<vfs_t::layer_t> vfs_t::cached_layer(sp<UMEM> payload, i64 mtime)
+{
+	if(payload == nullptr)
+		return nullptr;
+	sp<layer_t> layer = std::make_shared<layer_t>();
+	layer->backing = payload;
+	layer->mem = uview(payload.get(),0,usize(payload.get()));
+	layer->mtime = mtime;
+	layer->cost = usize(payload.get());
+	return layer;
+};
+
+binder_t* vfs_t::parse(layer_t* layer)
+{
+	if(layer->binder != nullptr)
+		return layer->binder;
+
+	char magic[4];
+	if(layer->mem->read_at(magic,4,0) != 4)
+		return nullptr;
+	std::string_view m(magic,4);
+	if(m != "BND3" && m != "BND4" && m != "BHF3" && m != "BHF4")
+		return nullptr;
+
+	layer->mem->seek(0,SEEK_SET);
+	layer->binder = binder_t::read(layer->mem);
+	return layer->binder;
+};
+
+sp<vfs_t::layer_t> vfs_t::open_entry(sp<layer_t> layer, const std::string& key, std::string_view name)
+{
+	binder_t* binder = nullptr;
+	file_header_t* fh = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(layer->mutex);
+		binder = parse(layer.get());
+		if(binder == nullptr)
+			return nullptr;
+
+		fh = binder->find(name);
+		if(fh == nullptr)
+		{
+			//most lookups only give the file name
+			std::vector<file_header_t>& headers = binder->get_headers();
+			for(i32 i = 0; i < headers.size() && fh == nullptr; i++)
+				if(headers[i].basename() == name)
+					fh = &headers[i];
+		}
+		if(fh == nullptr)
+			return nullptr;
+	}
+
+	//plain entries of a binder in memory are views into it
+	UMEM* src = binder->source();
+	UMEM* view = nullptr;
+	if(!src->is_file() && !(fh->flags() & file_flags_e::ff_compressed))
+	{
+		view = uview(src,fh->offset(),fh->compressed_size());
+		if(view == nullptr)
+			return nullptr;
+		if(!dcx_t::is_dcx(view))
+		{
+			sp<layer_t> entry = std::make_shared<layer_t>();
+			entry->mem = view;
+			entry->parent = layer;
+			entry->mtime = layer->mtime;
+			entry->cost = 0x100;
+			return entry;
+		}
+	}
+
+	//everything else is read out and inflated once, through the cache
+	layer_cache_t::key_t cache_key = {key,layer->mtime,fh->offset()};
+	sp<UMEM> payload = nullptr;
+	try
+	{
+		payload = layer_cache_t::global().get_or_load(cache_key,[&]() -> sp<UMEM>
+		{
+			if(view != nullptr)
+				return dcx_t::inflate(view);
+
+			sp<UMEM> raw(uopen(0),uclose);
+			if(fh->read(raw.get()) != 0)
+				throw std::runtime_error("vfs_t::open_entry() can't read "+std::string(name)+"\n");
+			raw->seek(0,SEEK_SET);
+			sp<UMEM> inflated = dcx_t::inflate(raw.get());
+			return inflated != nullptr ? inflated : raw;
+		});
+	}
+	catch(...)
+	{
+		uclose(view);
+		throw;
+	}
+	uclose(view);
+	return cached_layer(payload,layer->mtime);
+};
+
+sp<vfs_t::layer_t> vfs_t::resolve(const std::vector<std::string_view>& parts, size_t n)
+{
+	std::string key(parts[0]);
+	for(size_t i = 1; i < n; i++)
+	{
+		key.append(SEPARATOR);
+		key.append(parts[i]);
+	}
+
+	sp<layer_t> layer = cache_get(key);
+	if(layer != nullptr)
+		return layer;
+
+	if(n == 1)
+	{
+		layer = open_file(key);
+	}
+	else
+	{
+		sp<layer_t> parent = resolve(parts,n - 1);
+		if(parent == nullptr)
+			return nullptr;
+		layer = open_entry(parent,key.substr(0,key.size() - parts[n-1].size() - SEPARATOR.size()),parts[n-1]);
+	}
+	if(layer == nullptr)
+		return nullptr;
+
+	cache_put(key,layer);
+	return layer;
+};
+
+sp<UMEM> vfs_t::open(std::string_view vpath)
+{
+	std::vector<std::string_view> parts = split(vpath);
+	sp<layer_t> layer = resolve(parts,parts.size());
+	if(layer == nullptr)
+		return nullptr;
+
+	//plain files get their own handle so cursors aren't shared
+	if(layer->mem->is_file())
+	{
+		UMEM* mem = uopen(layer->mem->m_path,"rb");
+		if(!mem->can_read())
+		{
+			uclose(mem);
+			return nullptr;
+		}
+		return sp<UMEM>(mem,uclose);
+	}
+
+	UMEM* view = uview(layer->mem,0,usize(layer->mem));
+	return sp<UMEM>(view,[layer](UMEM* mem){uclose(mem);});
+};
+
+std::vector<std::string> vfs_t::list(std::string_view vpath)
+{
+	std::vector<std::string> names;
+	std::vector<std::string_view> parts = split(vpath);
+	sp<layer_t> layer = resolve(parts,parts.size());
+	if(layer == nullptr)
+		return names;
+
+	std::lock_guard<std::mutex> lock(layer->mutex);
+	binder_t* binder = parse(layer.get());
+	if(binder == nullptr)
+		return names;
+
+	const std::vector<file_header_t>& headers = binder->get_headers();
+	names.reserve(headers.size());
+	for(i32 i = 0; i < headers.size(); i++)
+		names.push_back(headers[i].name());
+	return names;
+};
+
+i64 vfs_t::cached_bytes() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_bytes;
+};
+
+void vfs_t::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_lru.clear();
+	m_index.clear();
+	m_bytes = 0;
+};
\ No newline at end of file
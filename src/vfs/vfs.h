@@ -0,0 +1,95 @@
+#pragma once
+#include "../common.h"
+#include "../util/umem.h"
+#include "../binder/binder.h"
+#include "layer_cache.h"
+#include <list>
+#include <mutex>
+#include <string_view>
+
+/*
+	opens files through nested containers by virtual path. layers are
+	separated by "//", so "chr/c5370.chrbnd.dcx//c5370.flver" is the entry
+	c5370.flver of the binder inside that dcx. dcx layers are unwrapped as
+	they are met and binder entries match by full path, then by basename.
+	intermediate layers stay in an lru bounded by their size in memory, so
+	paths that share parents only inflate them once. inflated payloads come
+	from the process wide layer_cache_t, so they are also shared between
+	vfs instances and threads
+*/
+class vfs_t
+{
+	//one opened container, the bytes of a file or entry with any dcx removed
+	struct layer_t
+	{
+		UMEM* mem = nullptr;
+		binder_t* binder = nullptr; //parsed on the first entry lookup
+		sp<layer_t> parent = nullptr; //kept alive while mem is a view into it
+		sp<UMEM> backing = nullptr; //cached payload mem is a view of
+		i64 mtime = 0; //of the os file at the bottom
+		std::mutex mutex; //guards parsing binder and the cursor of mem
+		i64 cost = 0; //bytes counted against the budget
+
+		~layer_t()
+		{
+			delete binder;
+			uclose(mem);
+		};
+	};
+
+	struct slot_t
+	{
+		std::string key;
+		sp<layer_t> layer;
+	};
+
+	mutable std::mutex m_mutex;
+	std::list<slot_t> m_lru = {}; //most recently used first
+	umap<std::string,std::list<slot_t>::iterator> m_index = {};
+	i64 m_budget = 0;
+	i64 m_bytes = 0;
+
+	sp<layer_t> cache_get(const std::string& key);
+
+	void cache_put(const std::string& key, sp<layer_t> layer);
+
+	//opens an os file as the bottom layer
+	static sp<layer_t> open_file(const std::string& path);
+
+	//layer over a payload from the layer cache
+	static sp<layer_t> cached_layer(sp<UMEM> payload, i64 mtime);
+
+	//the binder in layer, parsed on first use. layer's mutex must be held
+	static binder_t* parse(layer_t* layer);
+
+	//the entry called name in layer, key names layer for the cache
+	static sp<layer_t> open_entry(sp<layer_t> layer, const std::string& key, std::string_view name);
+
+	//layer for the first n parts of a path, from the cache when possible
+	sp<layer_t> resolve(const std::vector<std::string_view>& parts, size_t n);
+
+	public:
+	static constexpr std::string_view SEPARATOR = "//";
+
+	//budget is the most decompressed bytes kept for layers nothing is using
+	vfs_t(i64 budget = (i64)512 << 20) : m_budget(budget) {};
+
+	vfs_t(const vfs_t&) = delete;
+	vfs_t& operator=(const vfs_t&) = delete;
+
+	//splits a virtual path into its os path and the entry names below it
+	static std::vector<std::string_view> split(std::string_view vpath);
+
+	/*
+		opens vpath as read only memory, decompressed. the result keeps the
+		layers it points into alive, nullptr if a file or entry is missing
+	*/
+	sp<UMEM> open(std::string_view vpath);
+
+	//entry names of the binder at vpath, empty if it isn't one
+	std::vector<std::string> list(std::string_view vpath);
+
+	i64 cached_bytes() const;
+
+	void clear();
+};
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include "../src/binder/binder.h"
+#include "../src/binder/bnd4.h"
+
+/*
+	binders written by hand for the tests, so none of them need game files
+*/
+
+/*
+	a little endian bnd4 with ids, names and uncompressed sizes (format
+	0x2E). with bdt_path it is a bhf4 header instead and the data goes to a
+	bdf4 at bdt_path
+*/
+static void write_bnd4(const std::string& path, const std::vector<std::string>& datas, const std::string& bdt_path = "")
+{
+	const i64 FH_SIZE = 0x24;
+	bool split = !bdt_path.empty();
+	i32 n = datas.size();
+	i64 names_start = 0x40 + FH_SIZE * n;
+	i64 names_end = names_start + n * 6;
+
+	UMEM* mem = uopen(path,"wb");
+	mem->write((void*)(split ? "BHF4" : "BND4"),sizeof(char),4);
+	for(u8 b : {0,1,0,0,0,0,1,0})
+		mem->write_u8(b);
+	mem->write_i32(n);
+	mem->write_i64(0x40);
+	mem->write((void*)"00000000",sizeof(char),8);
+	mem->write_i64(FH_SIZE);
+	mem->write_i64(split ? 0 : names_end);
+	mem->write_u8(0);    //unicode
+	mem->write_u8(0x74); //format, bit reversed
+	mem->write_u8(0);
+	mem->write_u8(0);
+	mem->write_i32(0);
+	mem->write_i64(0);
+
+	UMEM* data = mem;
+	if(split)
+	{
+		data = uopen(bdt_path,"wb");
+		data->write((void*)"BDF4",sizeof(char),4);
+		for(u8 b : {0,1,0,0,0,0,1,0})
+			data->write_u8(b);
+		data->write_i32(0);
+		data->write_i64(0x30);
+		data->write((void*)"00000000",sizeof(char),8);
+		data->write_i64(0);
+		data->write_i64(0);
+	}
+
+	i64 pos = split ? 0x30 : names_end;
+	std::vector<i64> offsets;
+	for(const std::string& d : datas)
+	{
+		pos = (pos + 0xF) & ~(i64)0xF;
+		offsets.push_back(pos);
+		pos += d.size();
+	}
+	for(i32 i = 0; i < n; i++)
+	{
+		mem->write_u8(0x02); //uncompressed
+		mem->write_u8(0);
+		mem->write_u8(0);
+		mem->write_u8(0);
+		mem->write_i32(-1);
+		mem->write_i64(datas[i].size());
+		mem->write_i64(datas[i].size());
+		mem->write_u32(offsets[i]);
+		mem->write_i32(i);
+		mem->write_u32(names_start + i * 6);
+	}
+	for(i32 i = 0; i < n; i++)
+		mem->write_str("file"+std::to_string(i),true);
+	for(i32 i = 0; i < n; i++)
+	{
+		while(data->tell() < offsets[i])
+			data->write_u8(0);
+		data->write_str(datas[i],false);
+	}
+	if(split)
+		uclose(data);
+	uclose(mem);
+};
+
+//entry i of bnd, decompressed, or "!" if it can't be read
+static std::string read_entry(binder_t* bnd, i32 i)
+{
+	UMEM* out = uopen(0);
+	std::string str = "!";
+	if(bnd->get_headers()[i].read(out) == 0)
+		str = std::string((const char*)out->m_data,usize(out));
+	uclose(out);
+	return str;
+};
\ No newline at end of file
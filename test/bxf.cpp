@@ -0,0 +1,146 @@
+#include "binders.h"
+#include "../src/binder/bxf4.h"
+
+/*
+	round trips a bhf4/bdf4 pair: reads it, writes it back out with a
+	replaced entry, reads that and writes it again, which has to give the
+	same bytes. then commits into the pair and reads it once more, and
+	last checks that a pair missing its bdt fails reads and commits rather
+	than throwing. exits non zero on a failure
+*/
+
+static std::string slurp(const std::string& path)
+{
+	UMEM* mem = uopen(path,"rb");
+	std::string str = "";
+	if(mem->can_read())
+	{
+		str.resize(usize(mem));
+		mem->read(str.data(),1,str.size());
+	}
+	uclose(mem);
+	return str;
+};
+
+static bool check(const char* name, const std::string& bhd, const std::vector<std::string>& want)
+{
+	UMEM* mem = uopen(bhd,"rb");
+	binder_t* bnd = binder_t::read(mem);
+	bool ok = bnd != nullptr && bnd->split() && bnd->get_headers().size() == want.size();
+	for(i32 i = 0; ok && i < want.size(); i++)
+	{
+		ok = read_entry(bnd,i) == want[i];
+		if(!ok)
+			printf("%s: entry %d doesn't match\n",name,i);
+	}
+
+	//the batched reads have to agree
+	std::vector<std::string> got(want.size());
+	ok = ok && bnd->read_all([&](i32 i, UMEM* data)
+	{
+		got[i] = std::string((const char*)data->m_data,usize(data));
+		uclose(data);
+	},{1,4}) == 0 && got == want;
+	if(!ok)
+		printf("%s: doesn't read back\n",name);
+	delete bnd;
+	uclose(mem);
+	return ok;
+};
+
+//reads the pair at bhd and writes it to the pair at to, replacing entry i with data if it is given
+static bool copy(const std::string& bhd, const std::string& to, i32 i = -1, const std::string& data = "")
+{
+	UMEM* mem = uopen(bhd,"rb");
+	bxf4_t* bxf = dynamic_cast<bxf4_t*>(binder_t::read(mem));
+	UMEM* src = uopen(0);
+	src->write_str(data,false);
+	if(bxf != nullptr && i >= 0)
+		bxf->get_headers()[i].set_data(src);
+
+	UMEM* out_bhd = uopen(to+".bhd","wb");
+	UMEM* out_bdt = uopen(to+".bdt","wb");
+	bool ok = bxf != nullptr && bxf->write(out_bhd,out_bdt) == 0;
+	uclose(out_bhd);
+	uclose(out_bdt);
+	delete bxf;
+	uclose(src);
+	uclose(mem);
+	return ok;
+};
+
+int main(int argc, const char** argv)
+{
+	printf("Test: bxf\n");
+	std::string base = argc > 1 ? argv[1] : "test_bxf";
+	std::string a = base + "_a", b = base + "_b", c = base + "_c";
+
+	std::vector<std::string> want = {std::string(100,'A'),std::string(3000,'B'),"",std::string(20,'D')};
+	write_bnd4(a+".bhd",want,a+".bdt");
+	if(!check("hand written",a+".bhd",want))
+		return 1;
+
+	//entry 1 shrinks on the way through
+	want[1] = std::string(10,'b');
+	if(!copy(a+".bhd",b,1,want[1]) || !check("written",b+".bhd",want))
+		return 1;
+	if(!copy(b+".bhd",c) || !check("rewritten",c+".bhd",want))
+		return 1;
+	if(slurp(b+".bhd") != slurp(c+".bhd") || slurp(b+".bdt") != slurp(c+".bdt"))
+	{
+		printf("rewriting changed the bytes\n");
+		return 1;
+	}
+
+	//committed data goes to the bdt, the header is patched in place
+	{
+		UMEM* mem = uopen(c+".bhd","r+b");
+		binder_t* bnd = binder_t::read(mem);
+		want[3] = std::string(5000,'d');
+		UMEM* src = uopen(0);
+		src->write_str(want[3],false);
+		bnd->get_headers()[3].set_data(src);
+		bool ok = bnd->commit() == 0;
+		delete bnd;
+		uclose(src);
+		uclose(mem);
+		if(!ok || !check("committed",c+".bhd",want))
+			return 1;
+	}
+
+	//without its bdt the header still lists, but entry data fails
+	remove((c+".bdt").c_str());
+	{
+		UMEM* mem = uopen(c+".bhd","r+b");
+		binder_t* bnd = binder_t::read(mem);
+		i32 nulls = 0;
+		bool ok = bnd != nullptr && bnd->get_headers().size() == want.size();
+		ok = ok && bnd->read_all([&](i32 i, UMEM* data)
+		{
+			nulls += data == nullptr;
+			uclose(data);
+		}) != 0 && nulls == want.size();
+		if(ok)
+		{
+			UMEM* src = uopen(0);
+			bnd->get_headers()[0].set_data(src);
+			ok = bnd->commit() != 0;
+			uclose(src);
+		}
+		delete bnd;
+		uclose(mem);
+		if(!ok)
+		{
+			printf("a missing bdt wasn't reported\n");
+			return 1;
+		}
+	}
+
+	for(const std::string& p : {a,b,c})
+	{
+		remove((p+".bhd").c_str());
+		remove((p+".bdt").c_str());
+	}
+	printf("ok\n");
+	return 0;
+};
\ No newline at end of file
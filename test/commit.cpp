@@ -0,0 +1,73 @@
+#include "binders.h"
+
+/*
+	commits grown entries into a binder, reopening it between commits, and
+	checks every entry reads back intact. the entry that ends up last in
+	the file is grown in place past the end, so anything appended after it
+	has to start where it now ends. exits non zero on a mismatch
+*/
+
+static bool check(const std::string& path, const std::vector<std::string>& want)
+{
+	UMEM* mem = uopen(path,"rb");
+	binder_t* bnd = binder_t::read(mem);
+	bool ok = bnd != nullptr && bnd->get_headers().size() == want.size();
+	for(i32 i = 0; ok && i < want.size(); i++)
+	{
+		UMEM* out = uopen(0);
+		ok = bnd->get_headers()[i].read(out) == 0
+			&& usize(out) == want[i].size()
+			&& memcmp(out->m_data,want[i].data(),want[i].size()) == 0;
+		if(!ok)
+			printf("entry %d doesn't match\n",i);
+		uclose(out);
+	}
+	delete bnd;
+	uclose(mem);
+	return ok;
+};
+
+//replaces entry i with size bytes of c + i and commits, reopening the binder first
+static bool commit(const std::string& path, std::vector<std::string>& want, std::vector<std::pair<i32,i64>> edits, char c)
+{
+	UMEM* mem = uopen(path,"r+b");
+	binder_t* bnd = binder_t::read(mem);
+	std::vector<UMEM*> srcs;
+	for(auto [i,size] : edits)
+	{
+		want[i] = std::string(size,c + i);
+		UMEM* src = uopen(0);
+		src->write_str(want[i],false);
+		bnd->get_headers()[i].set_data(src);
+		srcs.push_back(src);
+	}
+	bool ok = bnd->commit() == 0;
+	delete bnd;
+	uclose(mem);
+	for(UMEM* src : srcs)
+		uclose(src);
+	return ok;
+};
+
+int main(int argc, const char** argv)
+{
+	printf("Test: commit\n");
+	std::string path = argc > 1 ? argv[1] : "test_commit.bnd";
+
+	std::vector<std::string> want = {std::string(1000,'A'),std::string(2000,'B'),std::string(3000,'C')};
+	write_bnd4(path,want);
+	if(!check(path,want))
+		return 1;
+
+	//entry 0 outgrows its slot and moves to the end
+	if(!commit(path,want,{{0,4000}},'a') || !check(path,want))
+		return 1;
+
+	//entry 0 grows in place past the end, entry 1 is appended after it
+	if(!commit(path,want,{{0,6000},{1,9000}},'a') || !check(path,want))
+		return 1;
+
+	remove(path.c_str());
+	printf("ok\n");
+	return 0;
+};
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "binders.h"
+
+/*
+	writes a binder holding repeated payloads with and without dedup, on
+	one thread and on several. every entry has to read back byte for byte,
+	repeats have to share one copy, and the output can't depend on how
+	many threads wrote it. exits non zero on a failure
+*/
+
+//the whole written binder as a string, empty if writing failed
+static std::string write(binder_t* bnd, bool dedup, i32 threads)
+{
+	write_options_t opts;
+	opts.dedup = dedup;
+	opts.threads = threads;
+	opts.window = threads > 1 ? 2 : 0;
+
+	UMEM* out = uopen(0);
+	std::string str = "";
+	if(bnd->write(out,opts) == 0)
+		str = std::string((const char*)out->m_data,usize(out));
+	uclose(out);
+	return str;
+};
+
+//reads bytes back as a binder and checks its entries, and which of them share an offset
+static bool check(const char* name, const std::string& bytes, const std::vector<std::string>& want, bool shared)
+{
+	UMEM* mem = uopen(bytes.size());
+	memcpy(mem->m_data,bytes.data(),bytes.size());
+	binder_t* bnd = binder_t::read(mem);
+	bool ok = bnd != nullptr && bnd->get_headers().size() == want.size();
+	for(i32 i = 0; ok && i < want.size(); i++)
+	{
+		if(read_entry(bnd,i) != want[i])
+		{
+			printf("%s: entry %d doesn't match\n",name,i);
+			ok = false;
+		}
+		for(i32 j = 0; ok && j < i; j++)
+		{
+			const file_header_t& a = bnd->get_headers()[i];
+			const file_header_t& b = bnd->get_headers()[j];
+			//empty entries may go anywhere
+			if(want[i].empty() || want[j].empty())
+				continue;
+			if((a.offset() == b.offset()) != (shared && want[i] == want[j]))
+			{
+				printf("%s: entries %d and %d %s an offset\n",name,j,i,a.offset() == b.offset() ? "share" : "don't share");
+				ok = false;
+			}
+		}
+	}
+	delete bnd;
+	uclose(mem);
+	return ok;
+};
+
+int main(int argc, const char** argv)
+{
+	printf("Test: dedup\n");
+	std::string path = argc > 1 ? argv[1] : "test_dedup.bnd";
+
+	std::string a(1000,'a'), b(500,'b'), c(700,'c'), d(5000,'d');
+	write_bnd4(path,{a,b,a,c,b,""});
+
+	UMEM* mem = uopen(path,"rb");
+	binder_t* bnd = binder_t::read(mem);
+	if(bnd == nullptr)
+		return 1;
+
+	//a replacement equal to an entry on disk, and two equal ones packed on write
+	UMEM* src_a = uopen(0);
+	src_a->write_str(a,false);
+	bnd->get_headers()[3].set_data(src_a);
+	UMEM* src_d = uopen(0);
+	src_d->write_str(d,false);
+	for(i32 id : {6,7})
+		bnd->add_file("packed"+std::to_string(id),id,file_flags_e::ff_compressed).set_data(src_d);
+	std::vector<std::string> want = {a,b,a,a,b,"",d,d};
+
+	bool ok = true;
+	std::string plain = write(bnd,false,1);
+	std::string deduped = write(bnd,true,1);
+	ok &= !plain.empty() && !deduped.empty();
+	ok &= check("plain",plain,want,false);
+	ok &= check("dedup",deduped,want,true);
+	if(ok && deduped.size() >= plain.size())
+	{
+		printf("dedup wrote %zu bytes, %zu without\n",deduped.size(),plain.size());
+		ok = false;
+	}
+	for(i32 threads : {2,4,8})
+	{
+		if(write(bnd,false,threads) != plain || write(bnd,true,threads) != deduped)
+		{
+			printf("%d threads wrote different bytes\n",threads);
+			ok = false;
+		}
+	}
+
+	delete bnd;
+	uclose(mem);
+	uclose(src_a);
+	uclose(src_d);
+	remove(path.c_str());
+	if(!ok)
+		return 1;
+	printf("ok\n");
+	return 0;
+};
\ No newline at end of file
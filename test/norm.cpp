@@ -0,0 +1,152 @@
+#include "../src/formats/flver/flver.h"
+#include "../src/formats/flver/norm.h"
+#include <random>
+
+/*
+	checks the bulk normalized attribute decoders bit for bit against the
+	scalar conversions, over both endians, vertex counts that leave every
+	tail length behind the vector loops, strides that aren't multiples of
+	four and destinations with fewer components than the source. floats
+	past what a decoder should write have to be left alone. exits non zero
+	on a mismatch
+*/
+
+static const float GUARD = -1234.5f;
+
+//deterministic bytes, so a failure reproduces
+static std::vector<u8> noise(i64 size, u32 seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<u8> v(size);
+	for(u8& b : v)
+		b = rng();
+	return v;
+};
+
+template <flver::norm_e N, bool BE>
+static bool check_norm4(const char* name, i64 count, i64 stride, i32 components, i64 dst_stride)
+{
+	std::vector<u8> src = noise(count * stride + 8,count * 131 + stride);
+	std::vector<float> simd(count * dst_stride + 8,GUARD);
+	std::vector<float> scalar(simd.size(),GUARD);
+	flver::decode_norm4<N,BE>(src.data(),count,stride,simd.data(),dst_stride,components);
+	flver::norm_detail::scalar<N,BE>(src.data(),count,stride,scalar.data(),dst_stride,components);
+
+	if(memcmp(simd.data(),scalar.data(),simd.size() * sizeof(float)) != 0)
+	{
+		printf("%s be %d: %lld vertices, stride %lld, %d of %lld floats differ from scalar\n",
+			name,BE,(long long)count,(long long)stride,components,(long long)dst_stride);
+		return false;
+	}
+	for(i64 i = 0; i < simd.size(); i++)
+	{
+		bool written = i < count * dst_stride && i % dst_stride < components;
+		if(!written && simd[i] != GUARD)
+		{
+			printf("%s be %d: float %lld was written\n",name,BE,(long long)i);
+			return false;
+		}
+	}
+	return true;
+};
+
+//the helpers vertex reads used before the bulk path, through a UMEM of the right endian
+template <flver::norm_e N, bool BE>
+static bool check_helpers(const char* name, float (*read)(UMEM*))
+{
+	const i64 COUNT = 37;
+	i64 stride = flver::norm_detail::width<N>() * 4;
+	std::vector<u8> src = noise(COUNT * stride,7);
+	std::vector<float> dst(COUNT * 4);
+	flver::decode_norm4<N,BE>(src.data(),COUNT,stride,dst.data(),4,4);
+
+	UMEM* mem = uopen(src.size());
+	memcpy(mem->m_data,src.data(),src.size());
+	mem->big_endian() = BE;
+	bool ok = true;
+	for(i64 i = 0; ok && i < COUNT * 4; i++)
+	{
+		float want = read(mem);
+		ok = memcmp(&want,&dst[i],sizeof(float)) == 0;
+		if(!ok)
+			printf("%s be %d: component %lld is %a, not %a\n",name,BE,(long long)i,dst[i],want);
+	}
+	uclose(mem);
+	return ok;
+};
+
+template <flver::norm_e N, bool BE>
+static bool check_all(const char* name)
+{
+	i64 width = flver::norm_detail::width<N>();
+	bool ok = true;
+	for(i64 count = 0; count <= 19; count++)
+		for(i64 stride : {width * 4,width * 4 + 1,width * 4 + 3,(i64)36})
+			for(auto [components,dst_stride] : {std::pair<i32,i64>{4,4},{3,3},{3,4},{4,6}})
+				ok &= check_norm4<N,BE>(name,count,stride,components,dst_stride);
+	ok &= check_norm4<N,BE>(name,1000,28,3,3);
+	return ok;
+};
+
+template <bool BE>
+static bool check_uv(i64 count, i64 stride)
+{
+	const float UV_FACTOR = 1024.0f;
+	std::vector<u8> src = noise(count * stride + 8,count + stride * 7);
+	std::vector<float> simd(count * 3 + 8,GUARD);
+	flver::decode_uv_i16<BE>(src.data(),count,stride,simd.data(),3,UV_FACTOR);
+
+	std::vector<float> scalar(simd.size(),GUARD);
+	UMEM* mem = uopen(src.size());
+	memcpy(mem->m_data,src.data(),src.size());
+	mem->big_endian() = BE;
+	for(i64 i = 0; i < count; i++)
+	{
+		mem->seek(i * stride,SEEK_SET);
+		scalar[i*3] = (float)mem->read_i16() / UV_FACTOR;
+		scalar[i*3+1] = (float)mem->read_i16() / UV_FACTOR;
+		scalar[i*3+2] = 0.0f / UV_FACTOR;
+	}
+	uclose(mem);
+
+	if(memcmp(simd.data(),scalar.data(),simd.size() * sizeof(float)) != 0)
+	{
+		printf("uv be %d: %lld vertices, stride %lld differ from scalar\n",BE,(long long)count,(long long)stride);
+		return false;
+	}
+	return true;
+};
+
+int main()
+{
+	printf("Test: norm\n");
+	bool ok = true;
+
+	ok &= check_all<flver::NORM_U8_BIASED,false>("u8 biased");
+	ok &= check_all<flver::NORM_U8,false>("u8");
+	ok &= check_all<flver::NORM_I8,false>("i8");
+	ok &= check_all<flver::NORM_I16,false>("i16");
+	ok &= check_all<flver::NORM_I16,true>("i16");
+	ok &= check_all<flver::NORM_U16_BIASED,false>("u16 biased");
+	ok &= check_all<flver::NORM_U16_BIASED,true>("u16 biased");
+
+	ok &= check_helpers<flver::NORM_U8_BIASED,false>("read_u8_norm",flver::read_u8_norm);
+	ok &= check_helpers<flver::NORM_I16,false>("read_i16_norm",flver::read_i16_norm);
+	ok &= check_helpers<flver::NORM_I16,true>("read_i16_norm",flver::read_i16_norm);
+	ok &= check_helpers<flver::NORM_U16_BIASED,false>("read_u16_norm",flver::read_u16_norm);
+	ok &= check_helpers<flver::NORM_U16_BIASED,true>("read_u16_norm",flver::read_u16_norm);
+
+	for(i64 count = 0; count <= 19; count++)
+	{
+		for(i64 stride : {4,5,12,36})
+		{
+			ok &= check_uv<false>(count,stride);
+			ok &= check_uv<true>(count,stride);
+		}
+	}
+
+	if(!ok)
+		return 1;
+	printf("ok\n");
+	return 0;
+};
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "../src/formats/flver/flver2.h"
+#include <random>
+
+/*
+	checks triangulate() against a window by window unroll through the
+	scalar emitter, over strips of every length up to a few blocks past
+	the eight window vector path, with restarts and degenerates kept and
+	dropped. then reads a flver2 written by hand, in both endians, and
+	checks its face counts against the header. exits non zero on a
+	mismatch
+*/
+
+//what triangulate() gives without the vector path
+static flver::triangles_t reference(const std::vector<i32>& indices, bool strip, bool restarts, bool degenerates)
+{
+	flver::triangles_t tris;
+	i64 count = indices.size();
+	i64 windows = strip ? std::max<i64>(count - 2,0) : count / 3;
+	std::vector<u32> out(windows * 3);
+	flver::tri_detail::emitter_t e = {out.data(),false,restarts,degenerates,tris};
+	for(i64 i = 0; i < windows; i++)
+	{
+		if(strip)
+			e.strip(indices[i],indices[i+1],indices[i+2]);
+		else
+			e.list(indices[i*3],indices[i*3+1],indices[i*3+2]);
+	}
+	out.resize(e.out - out.data());
+	tris.faces = out.size() / 3;
+	for(u32 index : out)
+		tris.wide |= index >= flver::STRIP_RESTART;
+	if(tris.wide)
+		tris.indices32 = out;
+	else
+		tris.indices16.assign(out.begin(),out.end());
+	return tris;
+};
+
+/*
+	count indices that mostly walk forward, with a repeat (a degenerate
+	window) or a restart now and then. wide ones climb past 16 bits
+*/
+static std::vector<i32> make_strip(i64 count, u32 seed, i32 repeat_pct, i32 restart_pct, bool wide)
+{
+	std::mt19937 rng(seed);
+	std::vector<i32> v(count);
+	i32 next = wide ? 0xFFF0 : 0;
+	for(i64 i = 0; i < count; i++)
+	{
+		i32 roll = rng() % 100;
+		if(i > 0 && roll < repeat_pct)
+			v[i] = v[i-1];
+		else if(roll < repeat_pct + restart_pct)
+			v[i] = flver::STRIP_RESTART;
+		else
+		{
+			next += next == flver::STRIP_RESTART;
+			v[i] = next++;
+		}
+	}
+	return v;
+};
+
+static bool check_triangulate(const char* name, const std::vector<i32>& indices, bool strip, bool restarts, bool degenerates)
+{
+	flver::triangles_t got = flver::triangulate(indices,strip,restarts,degenerates);
+	flver::triangles_t want = reference(indices,strip,restarts,degenerates);
+	if(got.wide != want.wide || got.faces != want.faces || got.total_faces != want.total_faces ||
+		got.degenerates != want.degenerates || got.indices16 != want.indices16 || got.indices32 != want.indices32)
+	{
+		printf("%s: %zu indices, strip %d restarts %d degenerates %d differ from scalar\n",
+			name,indices.size(),strip,restarts,degenerates);
+		return false;
+	}
+	return true;
+};
+
+struct faceset_desc_t
+{
+	u32 flags;
+	bool strip;
+	i32 index_size;
+	std::vector<i32> indices;
+};
+
+/*
+	a flver2 with one mesh, no vertices and the given face sets, laid out
+	as read() walks it: header, mesh, face sets, the mesh's face set
+	indices, then the index data
+*/
+static UMEM* write_flver(const std::vector<faceset_desc_t>& sets, bool big_endian, i32 true_faces, i32 total_faces)
+{
+	i32 n = sets.size();
+	i32 faceset_offset = 0x80 + 0x30 + 0x20 * n;
+	i32 data_offset = (faceset_offset + 4 * n + 0xF) & ~0xF;
+	std::vector<i32> offsets;
+	i32 data_len = 0;
+	for(const faceset_desc_t& fs : sets)
+	{
+		offsets.push_back(data_len);
+		data_len += (fs.indices.size() * fs.index_size / 8 + 0xF) & ~0xF;
+	}
+
+	UMEM* mem = uopen(0);
+	mem->write((void*)"FLVER\0",sizeof(char),6);
+	mem->write((void*)(big_endian ? "B\0" : "L\0"),sizeof(char),2);
+	mem->big_endian() = big_endian;
+	mem->write_i32(0x20014);
+	mem->write_i32(data_offset);
+	mem->write_i32(data_len);
+	for(i32 count : {0,0,0,1,0}) //dummies, materials, bones, meshes, vertex buffers
+		mem->write_i32(count);
+	for(i32 i = 0; i < 6; i++)
+		mem->write_f32(0.0f);
+	mem->write_i32(true_faces);
+	mem->write_i32(total_faces);
+	mem->write_u8(16); //vertex index size
+	mem->write_u8(1);  //unicode
+	mem->write_u8(0);
+	mem->write_u8(0);
+	mem->write_i32(0);
+	mem->write_i32(n);
+	mem->write_i32(0); //layouts
+	mem->write_i32(0); //textures
+	for(i32 i = 0; i < 4; i++)
+		mem->write_u8(0);
+	for(i32 i = 0; i < 8; i++)
+		mem->write_i32(0);
+
+	//mesh
+	for(i32 i = 0; i < 4; i++)
+		mem->write_u8(0);
+	for(i32 v : {0,0,0,-1,0,0,0,n,faceset_offset,0,0})
+		mem->write_i32(v);
+
+	for(i32 i = 0; i < n; i++)
+	{
+		const faceset_desc_t& fs = sets[i];
+		mem->write_u32(fs.flags);
+		mem->write_u8(fs.strip);
+		mem->write_u8(1);
+		mem->write_u16(0);
+		mem->write_i32(fs.indices.size());
+		mem->write_i32(offsets[i]);
+		mem->write_i32(fs.indices.size() * fs.index_size / 8);
+		mem->write_i32(0);
+		mem->write_i32(fs.index_size);
+		mem->write_i32(0);
+	}
+	for(i32 i = 0; i < n; i++)
+		mem->write_i32(i);
+
+	for(i32 i = 0; i < n; i++)
+	{
+		while(mem->tell() < data_offset + offsets[i])
+			mem->write_u8(0);
+		for(i32 index : sets[i].indices)
+		{
+			if(sets[i].index_size == 16)
+				mem->write_u16(index);
+			else
+				mem->write_i32(index);
+		}
+	}
+	while(mem->tell() < data_offset + data_len)
+		mem->write_u8(0);
+	mem->seek(0,SEEK_SET);
+	return mem;
+};
+
+//reads sets back as a flver2 whose header claims the given counts
+static bool face_counts_match(const std::vector<faceset_desc_t>& sets, bool big_endian, i32 true_faces, i32 total_faces)
+{
+	UMEM* mem = write_flver(sets,big_endian,true_faces,total_faces);
+	flver2_t flver;
+	bool match = flver.read(mem) == 0 && flver.check_face_counts();
+	uclose(mem);
+	return match;
+};
+
+static bool check_face_counts()
+{
+	std::vector<faceset_desc_t> sets = {
+		{0,false,16,make_strip(301,1,10,0,false)},
+		{0,true,16,make_strip(1001,2,5,5,false)},
+		{flver2_t::faceset_t::FS_LOD_LEVEL1,true,32,make_strip(77,3,20,10,false)},
+		{flver2_t::faceset_t::FS_MOTION_BLUR,true,16,make_strip(203,4,10,5,false)},
+	};
+
+	//counted the way the games write them, without triangulating
+	i32 true_faces = 0, total_faces = 0;
+	for(const faceset_desc_t& fs : sets)
+	{
+		const std::vector<i32>& v = fs.indices;
+		if(!fs.strip)
+		{
+			total_faces += v.size() / 3;
+			true_faces += v.size() / 3;
+			continue;
+		}
+		for(i64 i = 0; i + 2 < v.size(); i++)
+		{
+			i32 a = v[i], b = v[i+1], c = v[i+2];
+			if(a == flver::STRIP_RESTART || b == flver::STRIP_RESTART || c == flver::STRIP_RESTART)
+				continue;
+			total_faces++;
+			if(!(fs.flags & flver2_t::faceset_t::FS_MOTION_BLUR) && a != b && b != c && a != c)
+				true_faces++;
+		}
+	}
+
+	bool ok = true;
+	for(bool be : {false,true})
+	{
+		if(!face_counts_match(sets,be,true_faces,total_faces))
+		{
+			printf("be %d: face counts don't match the header\n",be);
+			ok = false;
+		}
+		if(face_counts_match(sets,be,true_faces + 1,total_faces) || face_counts_match(sets,be,true_faces,total_faces - 1))
+		{
+			printf("be %d: a wrong header count wasn't caught\n",be);
+			ok = false;
+		}
+	}
+	return ok;
+};
+
+int main()
+{
+	printf("Test: triangulate\n");
+	bool ok = true;
+
+	for(i64 count = 0; count <= 40; count++)
+	{
+		for(bool strip : {true,false})
+		{
+			for(bool restarts : {true,false})
+			{
+				for(bool degenerates : {true,false})
+				{
+					ok &= check_triangulate("clean",make_strip(count,count,0,0,false),strip,restarts,degenerates);
+					ok &= check_triangulate("mixed",make_strip(count,count + 100,10,5,false),strip,restarts,degenerates);
+					ok &= check_triangulate("wide",make_strip(count,count + 200,3,3,true),strip,restarts,degenerates);
+				}
+			}
+		}
+	}
+	for(i64 count : {1000,4099})
+		for(i32 pct : {0,1,10})
+			for(bool degenerates : {true,false})
+				ok &= check_triangulate("long",make_strip(count,count + pct,pct,pct,false),true,true,degenerates);
+
+	ok &= check_face_counts();
+
+	if(!ok)
+		return 1;
+	printf("ok\n");
+	return 0;
+};
\ No newline at end of file
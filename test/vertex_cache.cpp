@@ -0,0 +1,100 @@
+#include "../src/formats/flver/optimize.h"
+#include <array>
+#include <chrono>
+#include <random>
+
+/*
+	reorders a shuffled grid and a shuffled heap of small disconnected
+	patches for the vertex cache, checking the triangles are all still
+	there and the miss ratio went down. the patches dead end the cache
+	once per patch, which used to rescan every undrawn triangle each time.
+	exits non zero on a failure
+*/
+
+//a w by h grid of quads as triangles, first vertex at base
+static void add_grid(std::vector<u32>& indices, u32 base, i32 w, i32 h)
+{
+	for(i32 y = 0; y < h; y++)
+	{
+		for(i32 x = 0; x < w; x++)
+		{
+			u32 v = base + y * (w + 1) + x;
+			indices.insert(indices.end(),{v,v + w + 1,v + 1});
+			indices.insert(indices.end(),{v + 1,v + w + 1,v + w + 2});
+		}
+	}
+};
+
+//shuffles whole triangles, the same way every run
+static void shuffle(std::vector<u32>& indices)
+{
+	std::mt19937 rng(1234);
+	for(i64 t = indices.size() / 3 - 1; t > 0; t--)
+	{
+		i64 r = rng() % (t + 1);
+		std::swap_ranges(indices.begin() + t*3,indices.begin() + t*3 + 3,indices.begin() + r*3);
+	}
+};
+
+//triangles as sorted rotations, to compare sets regardless of order
+static std::vector<std::array<u32,3>> tri_set(const std::vector<u32>& indices)
+{
+	std::vector<std::array<u32,3>> tris;
+	for(i64 i = 0; i + 2 < indices.size(); i += 3)
+	{
+		std::array<u32,3> t = {indices[i],indices[i+1],indices[i+2]};
+		std::rotate(t.begin(),std::min_element(t.begin(),t.end()),t.end());
+		tris.push_back(t);
+	}
+	std::sort(tris.begin(),tris.end());
+	return tris;
+};
+
+static bool run(const char* name, std::vector<u32> indices, i64 vertex_count, float max_acmr)
+{
+	std::vector<std::array<u32,3>> before = tri_set(indices);
+	float acmr_before = flver::acmr(indices.data(),indices.size());
+
+	auto start = std::chrono::steady_clock::now();
+	flver::optimize_vertex_cache(indices.data(),indices.size(),vertex_count);
+	double ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	float acmr_after = flver::acmr(indices.data(),indices.size());
+	printf("%s: %lld triangles, acmr %.3f -> %.3f in %.1f ms\n",
+		name,(long long)(indices.size() / 3),acmr_before,acmr_after,ms);
+
+	if(tri_set(indices) != before)
+	{
+		printf("%s: triangles changed\n",name);
+		return false;
+	}
+	if(acmr_after > max_acmr)
+	{
+		printf("%s: acmr above %.3f\n",name,max_acmr);
+		return false;
+	}
+	return true;
+};
+
+int main()
+{
+	printf("Test: vertex cache\n");
+
+	std::vector<u32> grid;
+	add_grid(grid,0,300,300);
+	shuffle(grid);
+	if(!run("shuffled grid",grid,301 * 301,0.8f))
+		return 1;
+
+	//2x2 quad patches that share nothing
+	const i32 PATCHES = 25000;
+	std::vector<u32> patches;
+	for(i32 p = 0; p < PATCHES; p++)
+		add_grid(patches,p * 9,2,2);
+	shuffle(patches);
+	if(!run("disconnected patches",patches,PATCHES * 9,1.2f))
+		return 1;
+
+	printf("ok\n");
+	return 0;
+};
\ No newline at end of file